@@ -18025,6 +18025,346 @@ static void test_surface_format_conversion_alpha(void)
     DestroyWindow(window);
 }
 
+static BYTE yuv_to_rgb_component(int c)
+{
+    c >>= 8;
+    return c < 0 ? 0 : c > 255 ? 255 : c;
+}
+
+static void yuy2_to_rgb(const BYTE *src, unsigned int x, BYTE *r, BYTE *g, BYTE *b)
+{
+    int c = 298 * (src[x * 2] - 16), d = src[(x & ~1u) * 2 + 1] - 128, e = src[(x & ~1u) * 2 + 3] - 128;
+
+    *r = yuv_to_rgb_component(c + 409 * e + 128);
+    *g = yuv_to_rgb_component(c - 100 * d - 208 * e + 128);
+    *b = yuv_to_rgb_component(c + 516 * d + 128);
+}
+
+/* Compare the results of the software format conversions with a plain
+ * implementation, on rows long enough to use the vectorised paths and with
+ * a remainder. */
+static void test_sysmem_blt_conversion(void)
+{
+    static const DDPIXELFORMAT r5g6b5_format =
+    {
+        sizeof(DDPIXELFORMAT), DDPF_RGB, 0,
+        {16}, {0x0000f800}, {0x000007e0}, {0x0000001f}, {0x00000000}
+    };
+    static const DDPIXELFORMAT x8r8g8b8_format =
+    {
+        sizeof(DDPIXELFORMAT), DDPF_RGB, 0,
+        {32}, {0x00ff0000}, {0x0000ff00}, {0x000000ff}, {0x00000000}
+    };
+    static const DDPIXELFORMAT yuy2_format =
+    {
+        sizeof(DDPIXELFORMAT), DDPF_FOURCC, MAKEFOURCC('Y', 'U', 'Y', '2'),
+        {0}, {0}, {0}, {0}, {0}
+    };
+    static const struct
+    {
+        const DDPIXELFORMAT *src_format, *dst_format;
+        const char *name;
+        unsigned int width, height;
+        BOOL colour_key;
+    }
+    tests[] =
+    {
+        /* 259 * 256 pixels cover all 16-bit values. */
+        {&r5g6b5_format, &x8r8g8b8_format, "R5G6B5 -> X8R8G8B8", 259, 256},
+        {&yuy2_format,   &x8r8g8b8_format, "YUY2 -> X8R8G8B8",   258, 256},
+        {&yuy2_format,   &r5g6b5_format,   "YUY2 -> R5G6B5",     258, 256},
+        {&r5g6b5_format, &r5g6b5_format,   "R5G6B5 colour key",  259, 256, TRUE},
+    };
+    static const WORD key = 0x1234;
+    IDirectDrawSurface7 *src, *dst;
+    unsigned int i, x, y, expected;
+    DDSURFACEDESC2 surface_desc;
+    unsigned int got = 0;
+    IDirectDraw7 *ddraw;
+    BYTE r, g, b, *row;
+    ULONG refcount;
+    DDBLTFX fx;
+    HWND window;
+    HRESULT hr;
+
+    window = create_window();
+    ddraw = create_ddraw();
+    ok(!!ddraw, "Failed to create a ddraw object.\n");
+    hr = IDirectDraw7_SetCooperativeLevel(ddraw, window, DDSCL_NORMAL);
+    ok(hr == DD_OK, "Got unexpected hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(tests); ++i)
+    {
+        /* Software conversions look broken on Windows, see
+         * test_surface_format_conversion_alpha(). */
+        if (!tests[i].colour_key && strcmp(winetest_platform, "wine"))
+        {
+            skip("Skipping test %s.\n", tests[i].name);
+            continue;
+        }
+
+        memset(&surface_desc, 0, sizeof(surface_desc));
+        surface_desc.dwSize = sizeof(surface_desc);
+        surface_desc.dwFlags = DDSD_CAPS | DDSD_WIDTH | DDSD_HEIGHT | DDSD_PIXELFORMAT;
+        surface_desc.dwWidth = tests[i].width;
+        surface_desc.dwHeight = tests[i].height;
+        surface_desc.ddsCaps.dwCaps = DDSCAPS_OFFSCREENPLAIN | DDSCAPS_SYSTEMMEMORY;
+        U4(surface_desc).ddpfPixelFormat = *tests[i].src_format;
+        if (FAILED(hr = IDirectDraw7_CreateSurface(ddraw, &surface_desc, &src, NULL)))
+        {
+            skip("Failed to create source surface for test %s, hr %#x.\n", tests[i].name, hr);
+            continue;
+        }
+        U4(surface_desc).ddpfPixelFormat = *tests[i].dst_format;
+        hr = IDirectDraw7_CreateSurface(ddraw, &surface_desc, &dst, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        /* Multiplying by an odd number gives every 16-bit value once. */
+        hr = IDirectDrawSurface7_Lock(src, NULL, &surface_desc, DDLOCK_WAIT, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+        for (y = 0; y < tests[i].height; ++y)
+        {
+            row = (BYTE *)surface_desc.lpSurface + y * U1(surface_desc).lPitch;
+            for (x = 0; x < tests[i].width; ++x)
+                ((WORD *)row)[x] = tests[i].colour_key && !(x % 3) ? key : (y * tests[i].width + x) * 40503u;
+        }
+        hr = IDirectDrawSurface7_Unlock(src, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        if (tests[i].colour_key)
+        {
+            hr = IDirectDrawSurface7_Lock(dst, NULL, &surface_desc, DDLOCK_WAIT, NULL);
+            ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+            for (y = 0; y < tests[i].height; ++y)
+            {
+                row = (BYTE *)surface_desc.lpSurface + y * U1(surface_desc).lPitch;
+                for (x = 0; x < tests[i].width; ++x)
+                    ((WORD *)row)[x] = 0x5555;
+            }
+            hr = IDirectDrawSurface7_Unlock(dst, NULL);
+            ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+            memset(&fx, 0, sizeof(fx));
+            fx.dwSize = sizeof(fx);
+            fx.ddckSrcColorkey.dwColorSpaceLowValue = key;
+            fx.ddckSrcColorkey.dwColorSpaceHighValue = key;
+            hr = IDirectDrawSurface7_Blt(dst, NULL, src, NULL, DDBLT_WAIT | DDBLT_KEYSRCOVERRIDE, &fx);
+        }
+        else
+        {
+            hr = IDirectDrawSurface7_Blt(dst, NULL, src, NULL, DDBLT_WAIT, NULL);
+        }
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        hr = IDirectDrawSurface7_Lock(src, NULL, &surface_desc, DDLOCK_WAIT | DDLOCK_READONLY, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+        {
+            DDSURFACEDESC2 dst_desc;
+
+            memset(&dst_desc, 0, sizeof(dst_desc));
+            dst_desc.dwSize = sizeof(dst_desc);
+            hr = IDirectDrawSurface7_Lock(dst, NULL, &dst_desc, DDLOCK_WAIT | DDLOCK_READONLY, NULL);
+            ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+            expected = 0;
+            for (y = 0; y < tests[i].height; ++y)
+            {
+                const BYTE *src_row = (BYTE *)surface_desc.lpSurface + y * U1(surface_desc).lPitch;
+                const BYTE *dst_row = (BYTE *)dst_desc.lpSurface + y * U1(dst_desc).lPitch;
+
+                for (x = 0; x < tests[i].width; ++x)
+                {
+                    WORD pixel = ((const WORD *)src_row)[x];
+
+                    if (tests[i].colour_key)
+                    {
+                        expected = pixel == key ? 0x5555 : pixel;
+                        got = ((const WORD *)dst_row)[x];
+                    }
+                    else if (tests[i].src_format == &r5g6b5_format)
+                    {
+                        expected = ((pixel >> 11) * 255 + 15) / 31 << 16
+                                | (((pixel >> 5) & 0x3f) * 255 + 31) / 63 << 8
+                                | ((pixel & 0x1f) * 255 + 15) / 31;
+                        got = ((const DWORD *)dst_row)[x] & 0x00ffffff;
+                    }
+                    else if (tests[i].dst_format == &x8r8g8b8_format)
+                    {
+                        yuy2_to_rgb(src_row, x, &r, &g, &b);
+                        expected = r << 16 | g << 8 | b;
+                        got = ((const DWORD *)dst_row)[x] & 0x00ffffff;
+                    }
+                    else
+                    {
+                        yuy2_to_rgb(src_row, x, &r, &g, &b);
+                        expected = (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+                        got = ((const WORD *)dst_row)[x];
+                    }
+                    if (got != expected)
+                        break;
+                }
+                if (x < tests[i].width)
+                    break;
+            }
+            ok(y == tests[i].height, "Test %s: Got unexpected color 0x%08x at (%u, %u), expected 0x%08x.\n",
+                    tests[i].name, got, x, y, expected);
+
+            hr = IDirectDrawSurface7_Unlock(dst, NULL);
+            ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+        }
+        hr = IDirectDrawSurface7_Unlock(src, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        IDirectDrawSurface7_Release(dst);
+        IDirectDrawSurface7_Release(src);
+    }
+
+    refcount = IDirectDraw7_Release(ddraw);
+    ok(!refcount, "%u references left.\n", refcount);
+    DestroyWindow(window);
+}
+
+/* Blits of more than 256 KiB between separate surfaces are split in bands
+ * processed in parallel by wined3d's software blitter. Check that every
+ * pixel of the destination ends up with the expected value. */
+static void test_sysmem_blt_large(void)
+{
+    static const DDPIXELFORMAT x8r8g8b8_format =
+    {
+        sizeof(DDPIXELFORMAT), DDPF_RGB, 0,
+        {32}, {0x00ff0000}, {0x0000ff00}, {0x000000ff}, {0x00000000}
+    };
+    static const struct
+    {
+        const char *name;
+        unsigned int src_width, src_height;
+        unsigned int dst_width, dst_height;
+        BOOL colour_key;
+    }
+    tests[] =
+    {
+        {"colour key",           512, 512, 512, 512, TRUE},
+        {"stretch",              256, 256, 512, 512},
+        {"stretch, colour key",  256, 256, 512, 512, TRUE},
+        {"shrink, colour key",  1024, 1024, 512, 512, TRUE},
+    };
+    /* No source pixel value below has both bits 16-23 and 0-7 all set. */
+    static const DWORD key = 0x00ff00ff;
+    IDirectDrawSurface7 *src, *dst;
+    DDSURFACEDESC2 surface_desc, dst_desc;
+    unsigned int i, x, y, sx, sy;
+    DWORD expected = 0, got = 0;
+    IDirectDraw7 *ddraw;
+    ULONG refcount;
+    DDBLTFX fx;
+    HWND window;
+    HRESULT hr;
+    DWORD *row;
+
+    window = create_window();
+    ddraw = create_ddraw();
+    ok(!!ddraw, "Failed to create a ddraw object.\n");
+    hr = IDirectDraw7_SetCooperativeLevel(ddraw, window, DDSCL_NORMAL);
+    ok(hr == DD_OK, "Got unexpected hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(tests); ++i)
+    {
+        memset(&surface_desc, 0, sizeof(surface_desc));
+        surface_desc.dwSize = sizeof(surface_desc);
+        surface_desc.dwFlags = DDSD_CAPS | DDSD_WIDTH | DDSD_HEIGHT | DDSD_PIXELFORMAT;
+        surface_desc.dwWidth = tests[i].src_width;
+        surface_desc.dwHeight = tests[i].src_height;
+        surface_desc.ddsCaps.dwCaps = DDSCAPS_OFFSCREENPLAIN | DDSCAPS_SYSTEMMEMORY;
+        U4(surface_desc).ddpfPixelFormat = x8r8g8b8_format;
+        hr = IDirectDraw7_CreateSurface(ddraw, &surface_desc, &src, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+        surface_desc.dwWidth = tests[i].dst_width;
+        surface_desc.dwHeight = tests[i].dst_height;
+        hr = IDirectDraw7_CreateSurface(ddraw, &surface_desc, &dst, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        hr = IDirectDrawSurface7_Lock(src, NULL, &surface_desc, DDLOCK_WAIT, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+        for (y = 0; y < tests[i].src_height; ++y)
+        {
+            row = (DWORD *)((BYTE *)surface_desc.lpSurface + y * U1(surface_desc).lPitch);
+            for (x = 0; x < tests[i].src_width; ++x)
+                row[x] = tests[i].colour_key && !((x + y) % 3) ? key : y << 12 | x;
+        }
+        hr = IDirectDrawSurface7_Unlock(src, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        hr = IDirectDrawSurface7_Lock(dst, NULL, &surface_desc, DDLOCK_WAIT, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+        for (y = 0; y < tests[i].dst_height; ++y)
+        {
+            row = (DWORD *)((BYTE *)surface_desc.lpSurface + y * U1(surface_desc).lPitch);
+            for (x = 0; x < tests[i].dst_width; ++x)
+                row[x] = 0x00555555;
+        }
+        hr = IDirectDrawSurface7_Unlock(dst, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        if (tests[i].colour_key)
+        {
+            memset(&fx, 0, sizeof(fx));
+            fx.dwSize = sizeof(fx);
+            fx.ddckSrcColorkey.dwColorSpaceLowValue = key;
+            fx.ddckSrcColorkey.dwColorSpaceHighValue = key;
+            hr = IDirectDrawSurface7_Blt(dst, NULL, src, NULL, DDBLT_WAIT | DDBLT_KEYSRCOVERRIDE, &fx);
+        }
+        else
+        {
+            hr = IDirectDrawSurface7_Blt(dst, NULL, src, NULL, DDBLT_WAIT, NULL);
+        }
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        hr = IDirectDrawSurface7_Lock(src, NULL, &surface_desc, DDLOCK_WAIT | DDLOCK_READONLY, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+        memset(&dst_desc, 0, sizeof(dst_desc));
+        dst_desc.dwSize = sizeof(dst_desc);
+        hr = IDirectDrawSurface7_Lock(dst, NULL, &dst_desc, DDLOCK_WAIT | DDLOCK_READONLY, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        /* The scale factors are integers or their inverses, so point
+         * sampling picks the same source pixels however it rounds. */
+        for (y = 0; y < tests[i].dst_height; ++y)
+        {
+            const DWORD *dst_row = (const DWORD *)((BYTE *)dst_desc.lpSurface + y * U1(dst_desc).lPitch);
+            const DWORD *src_row;
+
+            sy = y * tests[i].src_height / tests[i].dst_height;
+            src_row = (const DWORD *)((BYTE *)surface_desc.lpSurface + sy * U1(surface_desc).lPitch);
+            for (x = 0; x < tests[i].dst_width; ++x)
+            {
+                sx = x * tests[i].src_width / tests[i].dst_width;
+                expected = src_row[sx] & 0x00ffffff;
+                if (tests[i].colour_key && expected == key)
+                    expected = 0x00555555;
+                got = dst_row[x] & 0x00ffffff;
+                if (got != expected)
+                    break;
+            }
+            if (x < tests[i].dst_width)
+                break;
+        }
+        ok(y == tests[i].dst_height, "Test %s: Got unexpected color 0x%08x at (%u, %u), expected 0x%08x.\n",
+                tests[i].name, got, x, y, expected);
+
+        hr = IDirectDrawSurface7_Unlock(dst, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+        hr = IDirectDrawSurface7_Unlock(src, NULL);
+        ok(hr == DD_OK, "Test %s: Got unexpected hr %#x.\n", tests[i].name, hr);
+
+        IDirectDrawSurface7_Release(dst);
+        IDirectDrawSurface7_Release(src);
+    }
+
+    refcount = IDirectDraw7_Release(ddraw);
+    ok(!refcount, "%u references left.\n", refcount);
+    DestroyWindow(window);
+}
+
 static void test_compressed_surface_stretch(void)
 {
     static const struct
@@ -19339,6 +19679,8 @@ START_TEST(ddraw7)
     test_caps();
     test_d32_support();
     test_surface_format_conversion_alpha();
+    test_sysmem_blt_conversion();
+    test_sysmem_blt_large();
     test_compressed_surface_stretch();
     test_cursor_clipping();
     test_window_position();
@@ -52,7 +52,81 @@ struct graphics_driver
 };
 
 
-DC_ATTR *get_dc_attr( HDC hdc )
+/* client-side batching of PatBlt calls on window DCs, see GdiSetBatchLimit.
+ * Only PatBlt has a win32u entry point that executes several calls at once. */
+
+#define GDI_BATCH_SIZE           64
+#define GDI_DEFAULT_BATCH_LIMIT  20
+
+struct gdi_batch
+{
+    DWORD      limit;  /* batch limit for the thread */
+    HDC        hdc;    /* DC and rop of the pending calls */
+    DWORD      rop;
+    DWORD      count;
+    POLYPATBLT rects[GDI_BATCH_SIZE];
+};
+
+static ULONG batch_index = FLS_OUT_OF_INDEXES;  /* fiber local storage index of the thread batch */
+static LONG batch_pending; /* number of threads with pending batched calls */
+
+static void flush_gdi_batch( struct gdi_batch *batch )
+{
+    DWORD err;
+
+    if (!batch->count) return;
+    TRACE( "flushing %u calls on %p\n", batch->count, batch->hdc );
+
+    /* errors can't be reported for batched calls */
+    err = GetLastError();
+    NtGdiPolyPatBlt( batch->hdc, batch->rop, batch->rects, batch->count, 0 );
+    SetLastError( err );
+
+    batch->count = 0;
+    InterlockedDecrement( &batch_pending );
+}
+
+static void WINAPI free_gdi_batch( void *ptr )
+{
+    struct gdi_batch *batch = ptr;
+
+    flush_gdi_batch( batch );
+    HeapFree( GetProcessHeap(), 0, batch );
+}
+
+void init_gdi_batch(void)
+{
+    /* batching is disabled if no index is available */
+    if (RtlFlsAlloc( free_gdi_batch, &batch_index ))
+    {
+        WARN( "no FLS index available, batching disabled\n" );
+        batch_index = FLS_OUT_OF_INDEXES;
+    }
+}
+
+static struct gdi_batch *get_gdi_batch( BOOL create )
+{
+    struct gdi_batch *batch;
+
+    if (batch_index == FLS_OUT_OF_INDEXES || RtlFlsGetValue( batch_index, (void **)&batch )) return NULL;
+    if (!batch && create && (batch = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*batch) )))
+    {
+        batch->limit = GDI_DEFAULT_BATCH_LIMIT;
+        RtlFlsSetValue( batch_index, batch );
+    }
+    return batch;
+}
+
+/* flush the batched calls of the current thread */
+void flush_batched_calls(void)
+{
+    struct gdi_batch *batch;
+
+    if (!batch_pending) return;
+    if ((batch = get_gdi_batch( FALSE ))) flush_gdi_batch( batch );
+}
+
+static DC_ATTR *lookup_dc_attr( HDC hdc )
 {
     DWORD type = gdi_handle_type( hdc );
     DC_ATTR *dc_attr;
@@ -64,6 +138,75 @@ DC_ATTR *get_dc_attr( HDC hdc )
     return dc_attr->disabled ? NULL : dc_attr;
 }
 
+/* any other call on a DC needs the batched calls to be executed first */
+DC_ATTR *get_dc_attr( HDC hdc )
+{
+    flush_batched_calls();
+    return lookup_dc_attr( hdc );
+}
+
+static BOOL batch_patblt( HDC hdc, INT left, INT top, INT width, INT height, DWORD rop )
+{
+    struct gdi_batch *batch;
+    DC_ATTR *dc_attr;
+
+    /* the bits of memory DCs may be accessed directly, only batch window DCs */
+    if (gdi_handle_type( hdc ) != NTGDI_OBJ_DC) return FALSE;
+    if (((rop >> 2) & 0x330000) != (rop & 0x330000)) return FALSE;  /* uses source */
+    if (!(batch = get_gdi_batch( TRUE )) || batch->limit <= 1) return FALSE;
+
+    if (batch->count && (batch->hdc != hdc || batch->rop != rop)) flush_gdi_batch( batch );
+    if (!(dc_attr = lookup_dc_attr( hdc )) || dc_attr->emf) return FALSE;
+
+    if (!batch->count)
+    {
+        batch->hdc = hdc;
+        batch->rop = rop;
+        InterlockedIncrement( &batch_pending );
+    }
+    batch->rects[batch->count].nXLeft  = left;
+    batch->rects[batch->count].nYLeft  = top;
+    batch->rects[batch->count].nWidth  = width;
+    batch->rects[batch->count].nHeight = height;
+    batch->rects[batch->count].hBrush  = 0;
+    if (++batch->count >= min( batch->limit, GDI_BATCH_SIZE )) flush_gdi_batch( batch );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           GdiFlush    (GDI32.@)
+ */
+BOOL WINAPI GdiFlush(void)
+{
+    flush_batched_calls();
+    return NtGdiFlush();
+}
+
+/***********************************************************************
+ *           GdiGetBatchLimit    (GDI32.@)
+ */
+DWORD WINAPI GdiGetBatchLimit(void)
+{
+    struct gdi_batch *batch = get_gdi_batch( FALSE );
+
+    return batch ? batch->limit : GDI_DEFAULT_BATCH_LIMIT;
+}
+
+/***********************************************************************
+ *           GdiSetBatchLimit    (GDI32.@)
+ */
+DWORD WINAPI GdiSetBatchLimit( DWORD limit )
+{
+    struct gdi_batch *batch;
+    DWORD prev;
+
+    if (!(batch = get_gdi_batch( TRUE ))) return 0;
+    flush_gdi_batch( batch );
+    prev = batch->limit;
+    batch->limit = limit ? limit : GDI_DEFAULT_BATCH_LIMIT;
+    return prev;
+}
+
 static BOOL is_display_device( const WCHAR *name )
 {
     const WCHAR *p = name;
@@ -1216,6 +1359,115 @@ BOOL WINAPI SetMiterLimit( HDC hdc, FLOAT limit, FLOAT *old_limit )
     return TRUE;
 }
 
+/***********************************************************************
+ *           GetPixel    (GDI32.@)
+ */
+COLORREF WINAPI GetPixel( HDC hdc, INT x, INT y )
+{
+    flush_batched_calls();
+    return NtGdiGetPixel( hdc, x, y );
+}
+
+/***********************************************************************
+ *           GetBoundsRect    (GDI32.@)
+ */
+UINT WINAPI GetBoundsRect( HDC hdc, RECT *rect, UINT flags )
+{
+    flush_batched_calls();
+    return NtGdiGetBoundsRect( hdc, rect, flags );
+}
+
+/***********************************************************************
+ *           SetBoundsRect    (GDI32.@)
+ */
+UINT WINAPI SetBoundsRect( HDC hdc, const RECT *rect, UINT flags )
+{
+    flush_batched_calls();
+    return NtGdiSetBoundsRect( hdc, rect, flags );
+}
+
+/***********************************************************************
+ *           SetVirtualResolution    (GDI32.@)
+ */
+BOOL WINAPI SetVirtualResolution( HDC hdc, DWORD horz_res, DWORD vert_res,
+                                  DWORD horz_size, DWORD vert_size )
+{
+    flush_batched_calls();
+    return NtGdiSetVirtualResolution( hdc, horz_res, vert_res, horz_size, vert_size );
+}
+
+/***********************************************************************
+ *           UpdateColors    (GDI32.@)
+ */
+BOOL WINAPI UpdateColors( HDC hdc )
+{
+    flush_batched_calls();
+    return NtGdiUpdateColors( hdc );
+}
+
+/***********************************************************************
+ *           GetClipBox    (GDI32.@)
+ */
+INT WINAPI GetClipBox( HDC hdc, RECT *rect )
+{
+    flush_batched_calls();
+    return NtGdiGetAppClipBox( hdc, rect );
+}
+
+/***********************************************************************
+ *           PtVisible    (GDI32.@)
+ */
+BOOL WINAPI PtVisible( HDC hdc, INT x, INT y )
+{
+    flush_batched_calls();
+    return NtGdiPtVisible( hdc, x, y );
+}
+
+/***********************************************************************
+ *           RectVisible    (GDI32.@)
+ */
+BOOL WINAPI RectVisible( HDC hdc, const RECT *rect )
+{
+    flush_batched_calls();
+    return NtGdiRectVisible( hdc, rect );
+}
+
+/***********************************************************************
+ *           GetRandomRgn    (GDI32.@)
+ */
+INT WINAPI GetRandomRgn( HDC hdc, HRGN region, INT code )
+{
+    flush_batched_calls();
+    return NtGdiGetRandomRgn( hdc, region, code );
+}
+
+/***********************************************************************
+ *           GetPath    (GDI32.@)
+ */
+INT WINAPI GetPath( HDC hdc, POINT *points, BYTE *types, INT size )
+{
+    flush_batched_calls();
+    return NtGdiGetPath( hdc, points, types, size );
+}
+
+/***********************************************************************
+ *           GdiDrawStream    (GDI32.@)
+ */
+BOOL WINAPI GdiDrawStream( HDC hdc, ULONG in, void *pvin )
+{
+    flush_batched_calls();
+    return NtGdiDrawStream( hdc, in, pvin );
+}
+
+/***********************************************************************
+ *           GdiSwapBuffers    (GDI32.@)
+ */
+BOOL WINAPI GdiSwapBuffers( HDC hdc )
+{
+    flush_batched_calls();
+    return NtGdiSwapBuffers( hdc );
+}
+
 /***********************************************************************
  *           SetPixel    (GDI32.@)
  */
@@ -1669,6 +1921,7 @@ BOOL WINAPI PatBlt( HDC hdc, INT left, INT top, INT width, INT height, DWORD rop
     DC_ATTR *dc_attr;
 
     if (is_meta_dc( hdc )) return METADC_PatBlt( hdc, left, top, width, height, rop );
+    if (batch_patblt( hdc, left, top, width, height, rop )) return TRUE;
     if (!(dc_attr = get_dc_attr( hdc ))) return FALSE;
     if (dc_attr->emf && !EMFDC_PatBlt( dc_attr, left, top, width, height, rop ))
         return FALSE;
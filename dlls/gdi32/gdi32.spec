@@ -178,12 +178,12 @@
 # @ stub GdiDeleteSpoolFileHandle
 @ stdcall GdiDescribePixelFormat(long long long ptr) NtGdiDescribePixelFormat
 @ stdcall GdiDllInitialize(ptr long ptr)
-@ stdcall GdiDrawStream(long long ptr) NtGdiDrawStream
+@ stdcall GdiDrawStream(long long ptr)
 # @ stub GdiEndDocEMF
 # @ stub GdiEndPageEMF
 @ stdcall GdiEntry13()
 # @ stub GdiFixUpHandle
-@ stdcall GdiFlush() NtGdiFlush
+@ stdcall GdiFlush()
 # @ stub GdiFullscreenControl
 @ stdcall GdiGetBatchLimit()
 @ stdcall GdiGetCharDimensions(long ptr ptr)
@@ -225,7 +225,7 @@
 @ stub GdiSetServerAttr
 # @ stub GdiStartDocEMF
 # @ stub GdiStartPageEMF
-@ stdcall GdiSwapBuffers(long) NtGdiSwapBuffers
+@ stdcall GdiSwapBuffers(long)
 @ stdcall GdiTransparentBlt(long long long long long long long long long long long)
 # @ stub GdiValidateHandle
 @ stub GdiWinWatchClose
@@ -239,7 +239,7 @@
 @ stdcall GetBitmapDimensionEx(long ptr) NtGdiGetBitmapDimension
 @ stdcall GetBkColor(long)
 @ stdcall GetBkMode(long)
-@ stdcall GetBoundsRect(long ptr long) NtGdiGetBoundsRect
+@ stdcall GetBoundsRect(long ptr long)
 # @ stub GetBrushAttributes
 @ stdcall GetBrushOrgEx(long ptr)
 @ stdcall GetCharABCWidthsA(long long long ptr)
@@ -258,7 +258,7 @@
 @ stub GetCharWidthWOW
 @ stdcall GetCharacterPlacementA(long str long long ptr long)
 @ stdcall GetCharacterPlacementW(long wstr long long ptr long)
-@ stdcall GetClipBox(long ptr) NtGdiGetAppClipBox
+@ stdcall GetClipBox(long ptr)
 @ stdcall GetClipRgn(long long)
 @ stdcall GetColorAdjustment(long ptr) NtGdiGetColorAdjustment
 @ stdcall GetColorSpace(long)
@@ -321,12 +321,12 @@
 @ stdcall GetOutlineTextMetricsA(long long ptr)
 @ stdcall GetOutlineTextMetricsW(long long ptr)
 @ stdcall GetPaletteEntries(long long long ptr)
-@ stdcall GetPath(long ptr ptr long) NtGdiGetPath
-@ stdcall GetPixel(long long long) NtGdiGetPixel
+@ stdcall GetPath(long ptr ptr long)
+@ stdcall GetPixel(long long long)
 @ stdcall GetPixelFormat(long)
 @ stdcall GetPolyFillMode(long)
 @ stdcall GetROP2(long)
-@ stdcall GetRandomRgn(long long long) NtGdiGetRandomRgn
+@ stdcall GetRandomRgn(long long long)
 @ stdcall GetRasterizerCaps(ptr long) NtGdiGetRasterizerCaps
 @ stdcall GetRegionData(long long ptr) NtGdiGetRegionData
 @ stdcall GetRelAbs(long long)
@@ -402,11 +402,11 @@
 @ stdcall Polyline(long ptr long)
 @ stdcall PolylineTo(long ptr long)
 @ stdcall PtInRegion(long long long) NtGdiPtInRegion
-@ stdcall PtVisible(long long long) NtGdiPtVisible
+@ stdcall PtVisible(long long long)
 # @ stub QueryFontAssocStatus
 @ stdcall RealizePalette(long)
 @ stdcall RectInRegion(long ptr) NtGdiRectInRegion
-@ stdcall RectVisible(long ptr) NtGdiRectVisible
+@ stdcall RectVisible(long ptr)
 @ stdcall Rectangle(long long long long long)
 @ stdcall RemoveFontMemResourceEx(ptr) NtGdiRemoveFontMemResourceEx
 @ stdcall RemoveFontResourceA(str)
@@ -473,7 +473,7 @@
 @ stdcall SetBitmapDimensionEx(long long long ptr) NtGdiSetBitmapDimension
 @ stdcall SetBkColor(long long)
 @ stdcall SetBkMode(long long)
-@ stdcall SetBoundsRect(long ptr long) NtGdiSetBoundsRect
+@ stdcall SetBoundsRect(long ptr long)
 # @ stub SetBrushAttributes
 @ stdcall SetBrushOrgEx(long long long ptr)
 @ stdcall SetColorAdjustment(long ptr) NtGdiSetColorAdjustment
@@ -515,7 +515,7 @@
 @ stdcall SetTextJustification(long long long)
 @ stdcall SetViewportExtEx(long long long ptr)
 @ stdcall SetViewportOrgEx(long long long ptr)
-@ stdcall SetVirtualResolution(long long long long long) NtGdiSetVirtualResolution
+@ stdcall SetVirtualResolution(long long long long long)
 @ stdcall SetWinMetaFileBits(long ptr long ptr)
 @ stdcall SetWindowExtEx(long long long ptr)
 @ stdcall SetWindowOrgEx(long long long ptr)
@@ -534,7 +534,7 @@
 @ stdcall TranslateCharsetInfo(ptr ptr long)
 @ stub UnloadNetworkFonts
 @ stdcall UnrealizeObject(long) NtGdiUnrealizeObject
-@ stdcall UpdateColors(long) NtGdiUpdateColors
+@ stdcall UpdateColors(long)
 @ stdcall UpdateICMRegKey(long str str long) UpdateICMRegKeyA
 @ stdcall UpdateICMRegKeyA(long str str long)
 @ stdcall UpdateICMRegKeyW(long wstr wstr long)
@@ -32,6 +32,8 @@
 void set_gdi_client_ptr( HGDIOBJ handle, void *ptr ) DECLSPEC_HIDDEN;
 void *get_gdi_client_ptr( HGDIOBJ handle, DWORD type ) DECLSPEC_HIDDEN;
 DC_ATTR *get_dc_attr( HDC hdc ) DECLSPEC_HIDDEN;
+void init_gdi_batch(void) DECLSPEC_HIDDEN;
+void flush_batched_calls(void) DECLSPEC_HIDDEN;
 HGDIOBJ get_full_gdi_handle( HGDIOBJ handle ) DECLSPEC_HIDDEN;
 void GDI_hdc_using_object( HGDIOBJ obj, HDC hdc,
                            void (*delete)( HDC hdc, HGDIOBJ handle )) DECLSPEC_HIDDEN;
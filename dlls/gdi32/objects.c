@@ -142,6 +142,7 @@ BOOL WINAPI DllMain( HINSTANCE inst, DWORD reason, LPVOID reserved )
 
     DisableThreadLibraryCalls( inst );
     gdi32_module = inst;
+    init_gdi_batch();
     return TRUE;
 }
 
@@ -1005,22 +1006,6 @@ DWORD WINAPI GdiInitializeLanguagePack( DWORD arg )
     return 0;
 }
 
-/***********************************************************************
- *           GdiGetBatchLimit    (GDI32.@)
- */
-DWORD WINAPI GdiGetBatchLimit(void)
-{
-    return 1;  /* FIXME */
-}
-
-/***********************************************************************
- *           GdiSetBatchLimit    (GDI32.@)
- */
-DWORD WINAPI GdiSetBatchLimit( DWORD limit )
-{
-    return 1; /* FIXME */
-}
-
 /* Solid colors to enumerate */
 static const COLORREF solid_colors[] =
 {
@@ -4099,6 +4099,71 @@ static void test_32bit_ddb(void)
     DeleteDC(hdcScreen);
 }
 
+/* rows wide enough to cover both vectorized and leftover pixels */
+static void test_32bit_dib_rows(void)
+{
+    BITMAPINFO info;
+    HBITMAP bmp_src, bmp_dst, old_src, old_dst;
+    DWORD *src_bits, *dst_bits;
+    HDC hdc_src, hdc_dst;
+    HBRUSH brush, old_brush;
+    unsigned int i;
+
+    memset(&info, 0, sizeof(info));
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = 11;
+    info.bmiHeader.biHeight = -1;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    hdc_src = CreateCompatibleDC(0);
+    hdc_dst = CreateCompatibleDC(0);
+    bmp_src = CreateDIBSection(hdc_src, &info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0);
+    bmp_dst = CreateDIBSection(hdc_dst, &info, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0);
+    old_src = SelectObject(hdc_src, bmp_src);
+    old_dst = SelectObject(hdc_dst, bmp_dst);
+
+    if (pGdiAlphaBlend)
+    {
+        BLENDFUNCTION blend;
+        BOOL ret;
+
+        blend.BlendOp = AC_SRC_OVER;
+        blend.BlendFlags = 0;
+        blend.SourceConstantAlpha = 128;
+        blend.AlphaFormat = AC_SRC_ALPHA;
+        for (i = 0; i < 11; i++)
+        {
+            src_bits[i] = 0x40201008;
+            dst_bits[i] = 0x80808080;
+        }
+        ret = pGdiAlphaBlend(hdc_dst, 0, 0, 11, 1, hdc_src, 0, 0, 11, 1, blend);
+        ok(ret, "GdiAlphaBlend failed err %u\n", GetLastError());
+        for (i = 0; i < 11; i++)
+            ok(dst_bits[i] == 0x90807874, "%u: wrong color %x\n", i, dst_bits[i]);
+    }
+
+    for (i = 0; i < 11; i++) dst_bits[i] = 0x12345678 + i;
+    brush = CreateSolidBrush(RGB(0x10, 0x20, 0x30));
+    old_brush = SelectObject(hdc_dst, brush);
+    PatBlt(hdc_dst, 1, 0, 9, 1, PATINVERT);
+    SelectObject(hdc_dst, old_brush);
+    DeleteObject(brush);
+    for (i = 0; i < 11; i++)
+    {
+        DWORD expect = (i && i < 10) ? (0x12345678 + i) ^ 0x102030 : 0x12345678 + i;
+        ok(dst_bits[i] == expect, "%u: expected %x, got %x\n", i, expect, dst_bits[i]);
+    }
+
+    SelectObject(hdc_dst, old_dst);
+    SelectObject(hdc_src, old_src);
+    DeleteObject(bmp_dst);
+    DeleteObject(bmp_src);
+    DeleteDC(hdc_dst);
+    DeleteDC(hdc_src);
+}
+
 /*
  * Used by test_GetDIBits_top_down to create the bitmap to test against.
  */
@@ -6008,6 +6073,7 @@ START_TEST(bitmap)
     test_GdiAlphaBlend();
     test_GdiGradientFill();
     test_32bit_ddb();
+    test_32bit_dib_rows();
     test_bitmapinfoheadersize();
     test_get16dibits();
     test_clipping();
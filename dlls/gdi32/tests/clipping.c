@@ -559,6 +559,75 @@ static void test_CreatePolyPolygonRgn(void)
     DeleteObject(region);
 }
 
+static void test_CombineRgn_rects(void)
+{
+    static const struct
+    {
+        RECT sub;
+        int count;
+        RECT rects[4];
+    }
+    tests[] =
+    {
+        { {20, 20, 30, 30}, 4, { {10, 10, 50, 20}, {10, 20, 20, 30}, {30, 20, 50, 30}, {10, 30, 50, 50} } },
+        { {0, 0, 60, 60}, 0 },
+        { {0, 20, 60, 30}, 2, { {10, 10, 50, 20}, {10, 30, 50, 50} } },
+        { {30, 0, 60, 60}, 1, { {10, 10, 30, 50} } },
+        { {0, 40, 20, 60}, 2, { {10, 10, 50, 40}, {20, 40, 50, 50} } },
+        { {60, 0, 70, 60}, 1, { {10, 10, 50, 50} } },
+    };
+    char buffer[sizeof(RGNDATAHEADER) + 8 * sizeof(RECT)];
+    RGNDATA *data = (RGNDATA *)buffer;
+    HRGN dst, src, sub;
+    const RECT *rects;
+    unsigned int i, j;
+    RECT rect;
+    int ret;
+
+    dst = CreateRectRgn( 0, 0, 0, 0 );
+    src = CreateRectRgn( 10, 10, 50, 50 );
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        sub = CreateRectRgnIndirect( &tests[i].sub );
+        ret = CombineRgn( dst, src, sub, RGN_DIFF );
+        ok( ret == (tests[i].count ? (tests[i].count == 1 ? SIMPLEREGION : COMPLEXREGION) : NULLREGION),
+            "%u: got %d\n", i, ret );
+        ret = GetRegionData( dst, sizeof(buffer), data );
+        ok( ret, "%u: GetRegionData failed\n", i );
+        ok( data->rdh.nCount == tests[i].count, "%u: got %u rects\n", i, data->rdh.nCount );
+        rects = (const RECT *)data->Buffer;
+        for (j = 0; j < min( data->rdh.nCount, tests[i].count ); j++)
+            ok( EqualRect( &rects[j], &tests[i].rects[j] ), "%u: rect %u got %s\n",
+                i, j, wine_dbgstr_rect( &rects[j] ));
+
+        /* subtracting from itself through the destination region */
+        CombineRgn( dst, src, 0, RGN_COPY );
+        CombineRgn( dst, dst, sub, RGN_DIFF );
+        ret = GetRegionData( dst, sizeof(buffer), data );
+        ok( data->rdh.nCount == tests[i].count, "%u: got %u rects\n", i, data->rdh.nCount );
+        DeleteObject( sub );
+    }
+
+    /* intersecting with a rectangle that contains the region */
+    sub = CreateRectRgn( 0, 0, 100, 100 );
+    CombineRgn( dst, src, 0, RGN_COPY );
+    SetRectRgn( src, 20, 20, 30, 30 );
+    CombineRgn( dst, dst, src, RGN_DIFF );
+    ret = CombineRgn( dst, dst, sub, RGN_AND );
+    ok( ret == COMPLEXREGION, "got %d\n", ret );
+    ret = GetRgnBox( dst, &rect );
+    ok( ret == COMPLEXREGION, "got %d\n", ret );
+    ok( rect.left == 10 && rect.top == 10 && rect.right == 50 && rect.bottom == 50,
+        "got %s\n", wine_dbgstr_rect( &rect ));
+    ret = GetRegionData( dst, sizeof(buffer), data );
+    ok( data->rdh.nCount == 4, "got %u rects\n", data->rdh.nCount );
+
+    DeleteObject( sub );
+    DeleteObject( src );
+    DeleteObject( dst );
+}
+
 START_TEST(clipping)
 {
     test_GetRandomRgn();
@@ -567,4 +636,5 @@ START_TEST(clipping)
     test_memory_dc_clipping();
     test_window_dc_clipping();
     test_CreatePolyPolygonRgn();
+    test_CombineRgn_rects();
 }
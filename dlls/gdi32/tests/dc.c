@@ -1698,6 +1698,69 @@ static void test_SetPixel(void)
     ok(c == ~0, "SetPixel returned: %x\n", c);
 }
 
+static void test_batch_limit(void)
+{
+    DWORD limit, prev;
+
+    limit = GdiGetBatchLimit();
+    ok(limit == 20, "got default batch limit %u\n", limit);
+
+    prev = GdiSetBatchLimit(5);
+    ok(prev == limit, "expected %u, got %u\n", limit, prev);
+    limit = GdiGetBatchLimit();
+    ok(limit == 5, "got batch limit %u\n", limit);
+
+    prev = GdiSetBatchLimit(1);
+    ok(prev == 5, "got previous batch limit %u\n", prev);
+
+    prev = GdiSetBatchLimit(0);
+    ok(prev == 1, "got previous batch limit %u\n", prev);
+    limit = GdiGetBatchLimit();
+    ok(limit == 20, "got batch limit %u after reset\n", limit);
+
+    ok(GdiFlush(), "GdiFlush failed\n");
+}
+
+static void test_batched_patblt(void)
+{
+    COLORREF color;
+    HWND hwnd;
+    HDC hdc;
+
+    hwnd = CreateWindowExA(0, "static", NULL, WS_POPUP|WS_VISIBLE, 0,0,100,100,
+                           0, 0, 0, NULL);
+    ok(hwnd != 0, "CreateWindowExA failed\n");
+    UpdateWindow(hwnd);
+    hdc = GetDC(hwnd);
+
+    PatBlt(hdc, 0, 0, 100, 100, WHITENESS);
+    color = GetPixel(hdc, 10, 10);
+    if (color == CLR_INVALID)
+    {
+        skip("can't read back window pixels\n");
+        ReleaseDC(hwnd, hdc);
+        DestroyWindow(hwnd);
+        return;
+    }
+    ok(color == 0xffffff, "got color %08x\n", color);
+
+    PatBlt(hdc, 0, 0, 100, 50, BLACKNESS);
+    color = GetPixel(hdc, 10, 10);
+    ok(color == 0, "got color %08x\n", color);
+    color = GetPixel(hdc, 10, 75);
+    ok(color == 0xffffff, "got color %08x\n", color);
+
+    /* the black rows are scrolled down over the white ones */
+    PatBlt(hdc, 0, 0, 100, 50, WHITENESS);
+    PatBlt(hdc, 0, 0, 100, 50, BLACKNESS);
+    ok(ScrollDC(hdc, 0, 50, NULL, NULL, 0, NULL), "ScrollDC failed\n");
+    color = GetPixel(hdc, 10, 75);
+    ok(color == 0, "got color %08x\n", color);
+
+    ReleaseDC(hwnd, hdc);
+    DestroyWindow(hwnd);
+}
+
 static void test_multi_monitor_dc(void)
 {
     INT value, count, old_count;
@@ -1932,5 +1995,7 @@ START_TEST(dc)
     test_pscript_printer_dc();
     test_clip_box();
     test_SetPixel();
+    test_batch_limit();
+    test_batched_patblt();
     test_multi_monitor_dc();
 }
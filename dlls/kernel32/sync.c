@@ -129,7 +129,10 @@ void WINAPI MakeCriticalSectionGlobal( CRITICAL_SECTION *crit )
 {
     /* let's assume that only one thread at a time will try to do this */
     HANDLE sem = crit->LockSemaphore;
-    if (!sem) NtCreateSemaphore( &sem, SEMAPHORE_ALL_ACCESS, NULL, 0, 1 );
+
+    /* local sections use LockSemaphore as a wake-up flag, turn it into the semaphore count */
+    if (crit->DebugInfo) NtCreateSemaphore( &sem, SEMAPHORE_ALL_ACCESS, NULL, sem ? 1 : 0, 1 );
+    else if (!sem) NtCreateSemaphore( &sem, SEMAPHORE_ALL_ACCESS, NULL, 0, 1 );
     crit->LockSemaphore = ConvertToGlobalHandle( sem );
     if (crit->DebugInfo != (void *)(ULONG_PTR)-1)
         RtlFreeHeap( GetProcessHeap(), 0, crit->DebugInfo );
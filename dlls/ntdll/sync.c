@@ -155,6 +155,22 @@ static BOOL crit_section_has_debuginfo( const RTL_CRITICAL_SECTION *crit )
     return crit->DebugInfo != NULL && crit->DebugInfo != no_debug_info_marker;
 }
 
+/* debug info is cleared by MakeCriticalSectionGlobal, the section may then be
+ * shared with other processes and needs a real semaphore */
+static BOOL crit_section_is_global( const RTL_CRITICAL_SECTION *crit )
+{
+    return crit->DebugInfo == NULL;
+}
+
+/* adaptive spinning: estimate of the number of spins needed to acquire a section,
+ * kept in a small hash table since there is no room left in the section itself */
+static LONG crit_spin_estimate[256];
+
+static inline LONG *get_spin_estimate( const RTL_CRITICAL_SECTION *crit )
+{
+    return &crit_spin_estimate[((ULONG_PTR)crit / sizeof(*crit)) % ARRAY_SIZE(crit_spin_estimate)];
+}
+
 static inline HANDLE get_semaphore( RTL_CRITICAL_SECTION *crit )
 {
     HANDLE ret = crit->LockSemaphore;
@@ -174,8 +190,7 @@ static inline NTSTATUS wait_semaphore( RTL_CRITICAL_SECTION *crit, int timeout )
 {
     LARGE_INTEGER time = {.QuadPart = timeout * (LONGLONG)-10000000};
 
-    /* debug info is cleared by MakeCriticalSectionGlobal */
-    if (!crit_section_has_debuginfo( crit ))
+    if (crit_section_is_global( crit ))
     {
         HANDLE sem = get_semaphore( crit );
         return NtWaitForSingleObject( sem, FALSE, &time );
@@ -282,7 +297,7 @@ NTSTATUS WINAPI RtlDeleteCriticalSection( RTL_CRITICAL_SECTION *crit )
             crit->DebugInfo = NULL;
         }
     }
-    else NtClose( crit->LockSemaphore );
+    else if (crit_section_is_global( crit )) NtClose( crit->LockSemaphore );
     crit->LockSemaphore = 0;
     return STATUS_SUCCESS;
 }
@@ -355,8 +370,7 @@ NTSTATUS WINAPI RtlpUnWaitCriticalSection( RTL_CRITICAL_SECTION *crit )
 {
     NTSTATUS ret;
 
-    /* debug info is cleared by MakeCriticalSectionGlobal */
-    if (!crit_section_has_debuginfo( crit ))
+    if (crit_section_is_global( crit ))
     {
         HANDLE sem = get_semaphore( crit );
         ret = NtReleaseSemaphore( sem, 1, NULL );
@@ -373,15 +387,6 @@ NTSTATUS WINAPI RtlpUnWaitCriticalSection( RTL_CRITICAL_SECTION *crit )
 }
 
 
-static inline void small_pause(void)
-{
-#ifdef __i386__
-    __asm__ __volatile__( "rep;nop" : : : "memory" );
-#else
-    __asm__ __volatile__( "" : : : "memory" );
-#endif
-}
-
 /******************************************************************************
  *      RtlEnterCriticalSection   (NTDLL.@)
  */
@@ -389,18 +394,24 @@ NTSTATUS WINAPI RtlEnterCriticalSection( RTL_CRITICAL_SECTION *crit )
 {
     if (crit->SpinCount)
     {
-        ULONG count;
+        LONG *estimate = get_spin_estimate( crit );
+        ULONG count, max_count = min( crit->SpinCount, (ULONG)*estimate * 2 + 16 );
 
         if (RtlTryEnterCriticalSection( crit )) return STATUS_SUCCESS;
-        for (count = crit->SpinCount; count > 0; count--)
+        for (count = 0; count < max_count; count++)
         {
             if (crit->LockCount > 0) break;  /* more than one waiter, don't bother spinning */
             if (crit->LockCount == -1)       /* try again */
             {
-                if (InterlockedCompareExchange( &crit->LockCount, 0, -1 ) == -1) goto done;
+                if (InterlockedCompareExchange( &crit->LockCount, 0, -1 ) == -1)
+                {
+                    *estimate += ((LONG)count - *estimate) / 8;
+                    goto done;
+                }
             }
-            small_pause();
+            YieldProcessor();
         }
+        *estimate += ((LONG)count - *estimate) / 8;
     }
 
     if (InterlockedIncrement( &crit->LockCount ))
@@ -860,19 +871,34 @@ struct futex_entry
     DWORD tid;
 };
 
-struct futex_queue
+/* each queue gets its own cache line, so that waiters on unrelated addresses
+ * don't contend on the same lock */
+struct DECLSPEC_ALIGN(64) futex_queue
 {
     struct list queue;
     LONG lock;
 };
 
-static struct futex_queue futex_queues[256];
+/* only the first futex_queue_count entries are used, depending on the number of CPUs */
+static struct futex_queue futex_queues[4096];
+static unsigned int futex_queue_count;
 
 static struct futex_queue *get_futex_queue( const void *addr )
 {
-    ULONG_PTR val = (ULONG_PTR)addr;
+    ULONG64 val = (ULONG_PTR)addr;
+    unsigned int count = futex_queue_count;
+
+    if (!count)
+    {
+        /* the result only depends on the processor count, so racing here is harmless */
+        count = 256;
+        while (count < ARRAY_SIZE(futex_queues) && count < NtCurrentTeb()->Peb->NumberOfProcessors * 64)
+            count <<= 1;
+        futex_queue_count = count;
+    }
 
-    return &futex_queues[(val >> 4) % ARRAY_SIZE(futex_queues)];
+    /* multiplicative hash, so that neighbouring addresses end up in different queues */
+    return &futex_queues[((val >> 2) * 0x9e3779b97f4a7c15ull >> 40) & (count - 1)];
 }
 
 static void spin_lock( LONG *lock )
@@ -603,6 +603,75 @@ static void test_wait_on_address(void)
     ok(address == 0, "got %s\n", wine_dbgstr_longlong(address));
 }
 
+static LONG wait_addresses[32];
+static LONG wait_wakeups[ARRAY_SIZE(wait_addresses)];
+
+static DWORD WINAPI wait_on_address_thread(void *arg)
+{
+    LONG *address = arg, compare = 0;
+    NTSTATUS status;
+
+    while (!*address)
+    {
+        status = pRtlWaitOnAddress(address, &compare, sizeof(*address), NULL);
+        ok(!status, "got 0x%08x\n", status);
+        InterlockedIncrement(&wait_wakeups[address - wait_addresses]);
+    }
+    return 0;
+}
+
+static void test_wait_on_address_multiple(void)
+{
+    HANDLE threads[ARRAY_SIZE(wait_addresses)];
+    unsigned int i;
+    DWORD ret;
+
+    if (!pRtlWaitOnAddress)
+    {
+        win_skip("RtlWaitOnAddress not supported, skipping test\n");
+        return;
+    }
+
+    /* waiters on neighbouring addresses only get woken by wakes on their own address */
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+        threads[i] = CreateThread(NULL, 0, wait_on_address_thread, &wait_addresses[i], 0, NULL);
+    Sleep(100);
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++)
+    {
+        ret = WaitForSingleObject(threads[i], 0);
+        ok(ret == WAIT_TIMEOUT, "%u: got %u\n", i, ret);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i += 2)
+    {
+        InterlockedExchange(&wait_addresses[i], 1);
+        pRtlWakeAddressSingle(&wait_addresses[i]);
+        ret = WaitForSingleObject(threads[i], 1000);
+        ok(!ret, "%u: got %u\n", i, ret);
+        ok(wait_wakeups[i] == 1, "%u: got %d wakeups\n", i, wait_wakeups[i]);
+        ret = WaitForSingleObject(threads[i + 1], 0);
+        ok(ret == WAIT_TIMEOUT, "%u: got %u\n", i + 1, ret);
+    }
+
+    /* a waiter woken by a wake on another address would have counted a wakeup
+     * and gone back to waiting */
+    Sleep(100);
+    for (i = 1; i < ARRAY_SIZE(threads); i += 2)
+        ok(!wait_wakeups[i], "%u: got %d wakeups\n", i, wait_wakeups[i]);
+
+    for (i = 1; i < ARRAY_SIZE(threads); i += 2)
+    {
+        InterlockedExchange(&wait_addresses[i], 1);
+        pRtlWakeAddressAll(&wait_addresses[i]);
+        ret = WaitForSingleObject(threads[i], 1000);
+        ok(!ret, "%u: got %u\n", i, ret);
+        ok(wait_wakeups[i] == 1, "%u: got %d wakeups\n", i, wait_wakeups[i]);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); i++) CloseHandle(threads[i]);
+}
+
 static HANDLE thread_ready, thread_done;
 
 static DWORD WINAPI resource_shared_thread(void *arg)
@@ -942,6 +1011,7 @@ START_TEST(sync)
     pRtlWakeAddressSingle           = (void *)GetProcAddress(module, "RtlWakeAddressSingle");
 
     test_wait_on_address();
+    test_wait_on_address_multiple();
     test_event();
     test_mutant();
     test_semaphore();
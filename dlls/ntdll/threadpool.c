@@ -30,6 +30,7 @@
 
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 
 #include "ntdll_misc.h"
 
@@ -98,6 +99,10 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
+/* Each wait bucket thread waits on at most MAXIMUM_WAITQUEUE_OBJECTS handles
+ * plus its update event. Waiting on all registered objects from a single
+ * thread needs a server (or esync/fsync) interface for unbounded wait sets,
+ * so that is left for a separate change. */
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
 /* internal threadpool representation */
@@ -178,7 +183,8 @@ struct threadpool_object
             /* information about the timer, locked via timerqueue.cs */
             BOOL            timer_initialized;
             BOOL            timer_pending;
-            struct list     timer_entry;
+            struct wine_rb_entry timer_entry;
+            ULONGLONG       timer_seq;
             BOOL            timer_set;
             ULONGLONG       timeout;
             LONG            period;
@@ -238,13 +244,16 @@ struct threadpool_group
 
 /* global timerqueue object */
 static RTL_CRITICAL_SECTION_DEBUG timerqueue_debug;
+static int compare_timer_timeout( const void *key, const struct wine_rb_entry *entry );
 
 static struct
 {
     CRITICAL_SECTION        cs;
     LONG                    objcount;
     BOOL                    thread_running;
-    struct list             pending_timers;
+    /* pending timers, sorted by timeout and insertion order */
+    struct wine_rb_tree     pending_timers;
+    ULONGLONG               timer_seq;
     RTL_CONDITION_VARIABLE  update_event;
 }
 timerqueue =
@@ -252,7 +261,8 @@ timerqueue =
     { &timerqueue_debug, -1, 0, 0, 0, 0 },      /* cs */
     0,                                          /* objcount */
     FALSE,                                      /* thread_running */
-    LIST_INIT( timerqueue.pending_timers ),     /* pending_timers */
+    { compare_timer_timeout },                  /* pending_timers */
+    0,                                          /* timer_seq */
     RTL_CONDITION_VARIABLE_INIT                 /* update_event */
 };
 
@@ -1041,6 +1051,44 @@ NTSTATUS WINAPI RtlDeleteTimer(HANDLE TimerQueue, HANDLE Timer,
     return status;
 }
 
+/* timers with the same timeout are kept in the order they were queued */
+static int compare_timer_timeout( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct threadpool_object *timer = key;
+    const struct threadpool_object *other = WINE_RB_ENTRY_VALUE( entry, struct threadpool_object, u.timer.timer_entry );
+
+    if (timer->u.timer.timeout != other->u.timer.timeout)
+        return timer->u.timer.timeout < other->u.timer.timeout ? -1 : 1;
+    if (timer->u.timer.timer_seq != other->u.timer.timer_seq)
+        return timer->u.timer.timer_seq < other->u.timer.timer_seq ? -1 : 1;
+    return 0;
+}
+
+/***********************************************************************
+ *           timerqueue_add_timer    (internal)
+ *
+ * Inserts a timer into the pending timers, timerqueue.cs has to be held.
+ */
+static void timerqueue_add_timer( struct threadpool_object *timer )
+{
+    assert( timer->type == TP_OBJECT_TYPE_TIMER );
+    timer->u.timer.timer_seq = timerqueue.timer_seq++;
+    wine_rb_put( &timerqueue.pending_timers, timer, &timer->u.timer.timer_entry );
+    timer->u.timer.timer_pending = TRUE;
+}
+
+/***********************************************************************
+ *           timerqueue_remove_timer    (internal)
+ *
+ * Removes a pending timer, timerqueue.cs has to be held.
+ */
+static void timerqueue_remove_timer( struct threadpool_object *timer )
+{
+    assert( timer->u.timer.timer_pending );
+    wine_rb_remove( &timerqueue.pending_timers, &timer->u.timer.timer_entry );
+    timer->u.timer.timer_pending = FALSE;
+}
+
 /***********************************************************************
  *           timerqueue_thread_proc    (internal)
  */
@@ -1049,7 +1097,7 @@ static void CALLBACK timerqueue_thread_proc( void *param )
     ULONGLONG timeout_lower, timeout_upper, new_timeout;
     struct threadpool_object *other_timer;
     LARGE_INTEGER now, timeout;
-    struct list *ptr;
+    struct wine_rb_entry *ptr;
 
     TRACE( "starting timer queue thread\n" );
 
@@ -1059,17 +1107,16 @@ static void CALLBACK timerqueue_thread_proc( void *param )
         NtQuerySystemTime( &now );
 
         /* Check for expired timers. */
-        while ((ptr = list_head( &timerqueue.pending_timers )))
+        while ((ptr = wine_rb_head( timerqueue.pending_timers.root )))
         {
-            struct threadpool_object *timer = LIST_ENTRY( ptr, struct threadpool_object, u.timer.timer_entry );
+            struct threadpool_object *timer = WINE_RB_ENTRY_VALUE( ptr, struct threadpool_object, u.timer.timer_entry );
             assert( timer->type == TP_OBJECT_TYPE_TIMER );
             assert( timer->u.timer.timer_pending );
             if (timer->u.timer.timeout > now.QuadPart)
                 break;
 
             /* Queue a new callback in one of the worker threads. */
-            list_remove( &timer->u.timer.timer_entry );
-            timer->u.timer.timer_pending = FALSE;
+            timerqueue_remove_timer( timer );
             tp_object_submit( timer, FALSE );
 
             /* Insert the timer back into the queue, except it's marked for shutdown. */
@@ -1079,23 +1126,15 @@ static void CALLBACK timerqueue_thread_proc( void *param )
                 if (timer->u.timer.timeout <= now.QuadPart)
                     timer->u.timer.timeout = now.QuadPart + 1;
 
-                LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                                     struct threadpool_object, u.timer.timer_entry )
-                {
-                    assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
-                    if (timer->u.timer.timeout < other_timer->u.timer.timeout)
-                        break;
-                }
-                list_add_before( &other_timer->u.timer.timer_entry, &timer->u.timer.timer_entry );
-                timer->u.timer.timer_pending = TRUE;
+                timerqueue_add_timer( timer );
             }
         }
 
         timeout_lower = timeout_upper = MAXLONGLONG;
 
         /* Determine next timeout and use the window length to optimize wakeup times. */
-        LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                             struct threadpool_object, u.timer.timer_entry )
+        WINE_RB_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
+                                struct threadpool_object, u.timer.timer_entry )
         {
             assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
             if (other_timer->u.timer.timeout >= timeout_upper)
@@ -1133,22 +1172,35 @@ static void CALLBACK timerqueue_thread_proc( void *param )
 }
 
 /***********************************************************************
- *           tp_new_worker_thread    (internal)
+ *           tp_create_worker_thread    (internal)
  *
- * Create and account a new worker thread for the desired pool.
+ * Create a worker thread for the desired pool. The caller accounts for it,
+ * either before (without holding the pool lock) or after (with the lock held).
  */
-static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
+static NTSTATUS tp_create_worker_thread( struct threadpool *pool )
 {
     HANDLE thread;
     NTSTATUS status;
 
     status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0, 0, 0,
                                   threadpool_worker_proc, pool, &thread, NULL );
-    if (status == STATUS_SUCCESS)
+    if (status == STATUS_SUCCESS) NtClose( thread );
+    return status;
+}
+
+/***********************************************************************
+ *           tp_new_worker_thread    (internal)
+ *
+ * Create and account a new worker thread for the desired pool.
+ */
+static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
+{
+    NTSTATUS status;
+
+    if ((status = tp_create_worker_thread( pool )) == STATUS_SUCCESS)
     {
         InterlockedIncrement( &pool->refcount );
         pool->num_workers++;
-        NtClose( thread );
     }
     return status;
 }
@@ -1210,15 +1262,12 @@ static void tp_timerqueue_unlock( struct threadpool_object *timer )
     {
         /* If timer was pending, remove it. */
         if (timer->u.timer.timer_pending)
-        {
-            list_remove( &timer->u.timer.timer_entry );
-            timer->u.timer.timer_pending = FALSE;
-        }
+            timerqueue_remove_timer( timer );
 
         /* If the last timer object was destroyed, then wake up the thread. */
         if (!--timerqueue.objcount)
         {
-            assert( list_empty( &timerqueue.pending_timers ) );
+            assert( !timerqueue.pending_timers.root );
             RtlWakeAllConditionVariable( &timerqueue.update_event );
         }
 
@@ -1971,16 +2020,23 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
     NTSTATUS status = STATUS_UNSUCCESSFUL;
+    BOOL new_worker = FALSE;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
     RtlEnterCriticalSection( &pool->cs );
 
-    /* Start new worker threads if required. */
+    /* Account for a new worker thread if required. The thread itself is
+     * created after leaving the lock, so that concurrent submissions don't
+     * have to wait for the server call. */
     if (pool->num_busy_workers >= pool->num_workers &&
         pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    {
+        InterlockedIncrement( &pool->refcount );
+        pool->num_workers++;
+        new_worker = TRUE;
+    }
 
     /* Queue work item and increment refcount. */
     InterlockedIncrement( &object->refcount );
@@ -1991,14 +2047,28 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
         object->u.wait.signaled++;
 
-    /* No new thread started - wake up one existing thread. */
-    if (status != STATUS_SUCCESS)
+    assert( pool->num_workers > 0 );
+
+    RtlLeaveCriticalSection( &pool->cs );
+
+    if (new_worker && (status = tp_create_worker_thread( pool )))
     {
+        RtlEnterCriticalSection( &pool->cs );
+        pool->num_workers--;
         assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
+        RtlLeaveCriticalSection( &pool->cs );
     }
 
-    RtlLeaveCriticalSection( &pool->cs );
+    /* No new thread started - wake up one existing thread. The wake can be
+     * done outside of the lock, as waiters only sleep after checking the
+     * queue with the lock held. */
+    if (status != STATUS_SUCCESS)
+        RtlWakeConditionVariable( &pool->update_event );
+
+    /* drop the reference taken for the thread that couldn't be created,
+     * the submitted object may already have released its own */
+    if (new_worker && status != STATUS_SUCCESS)
+        tp_threadpool_release( pool );
 }
 
 /***********************************************************************
@@ -2956,7 +3026,6 @@ BOOL WINAPI TpSetPoolMinThreads( TP_POOL *pool, DWORD minimum )
 VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LONG window_length )
 {
     struct threadpool_object *this = impl_from_TP_TIMER( timer );
-    struct threadpool_object *other_timer;
     BOOL submit_timer = FALSE;
     ULONGLONG timestamp;
 
@@ -2994,10 +3063,7 @@ VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LO
 
     /* First remove existing timeout. */
     if (this->u.timer.timer_pending)
-    {
-        list_remove( &this->u.timer.timer_entry );
-        this->u.timer.timer_pending = FALSE;
-    }
+        timerqueue_remove_timer( this );
 
     /* If the timer was enabled, then add it back to the queue. */
     if (timeout)
@@ -3006,20 +3072,11 @@ VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LO
         this->u.timer.period        = period;
         this->u.timer.window_length = window_length;
 
-        LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                             struct threadpool_object, u.timer.timer_entry )
-        {
-            assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
-            if (this->u.timer.timeout < other_timer->u.timer.timeout)
-                break;
-        }
-        list_add_before( &other_timer->u.timer.timer_entry, &this->u.timer.timer_entry );
+        timerqueue_add_timer( this );
 
         /* Wake up the timer thread when the timeout has to be updated. */
-        if (list_head( &timerqueue.pending_timers ) == &this->u.timer.timer_entry )
+        if (wine_rb_head( timerqueue.pending_timers.root ) == &this->u.timer.timer_entry)
             RtlWakeAllConditionVariable( &timerqueue.update_event );
-
-        this->u.timer.timer_pending = TRUE;
     }
 
     RtlLeaveCriticalSection( &timerqueue.cs );
@@ -65,6 +65,8 @@
 #endif
 
 #include <sys/uio.h>
+#include <sys/time.h>
+#include <dirent.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -2276,6 +2278,436 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
 }
 
 
+/* on-disk cache of relocated image pages, enabled with WINE_RELOC_CACHE=1 */
+
+#define RELOC_CACHE_MAGIC    0x434c4552  /* 'RELC' */
+#define RELOC_CACHE_VERSION  1
+#define RELOC_CACHE_MAX_SIZE (256 << 20)  /* total size of the cache directory */
+
+struct reloc_cache_header
+{
+    unsigned int magic;       /* RELOC_CACHE_MAGIC */
+    unsigned int version;     /* RELOC_CACHE_VERSION */
+    ULONG64      dev;         /* identity of the image file */
+    ULONG64      ino;
+    ULONG64      size;
+    ULONG64      mtime;
+    ULONG64      base;        /* address the pages are relocated for */
+    unsigned int image_size;  /* size of the mapped image */
+    unsigned int count;       /* number of relocated pages */
+    /* followed by count page rvas, the page data starts at the next page boundary */
+};
+
+/* state of the relocation of an image through the cache */
+struct reloc_cache
+{
+    const char   *dir;        /* cache directory, NULL if the cache is disabled */
+    struct stat   st;         /* image file */
+    char         *name;       /* cache file for the image */
+    int           fd;         /* cache file to load from, or -1 */
+    unsigned int *rvas;       /* relocated pages */
+    unsigned int  count;
+    off_t         data_pos;   /* offset of the page data in the cache file */
+    char         *data;       /* copy of the relocated pages to store */
+};
+
+/* called without virtual_mutex, so racing threads may both initialize the
+ * directory; the result is the same either way */
+static const char *get_reloc_cache_dir(void)
+{
+    static const char *reloc_cache_dir;
+    static BOOL initialized;
+    const char *env_var;
+    char *dir = NULL;
+
+    if (initialized) return reloc_cache_dir;
+
+    if ((env_var = getenv( "WINE_RELOC_CACHE" )) && atoi( env_var ) && config_dir &&
+        (dir = malloc( strlen( config_dir ) + sizeof("/reloc_cache") )))
+    {
+        strcpy( dir, config_dir );
+        strcat( dir, "/reloc_cache" );
+        if (mkdir( dir, 0777 ) == -1 && errno != EEXIST)
+        {
+            WARN_(module)( "cannot create %s, relocation cache disabled\n", dir );
+            free( dir );
+            dir = NULL;
+        }
+    }
+    reloc_cache_dir = dir;
+    initialized = TRUE;
+    return reloc_cache_dir;
+}
+
+static void free_reloc_cache( struct reloc_cache *cache )
+{
+    if (cache->fd != -1) close( cache->fd );
+    free( cache->name );
+    free( cache->rvas );
+    free( cache->data );
+    cache->fd = -1;
+    cache->name = NULL;
+    cache->rvas = NULL;
+    cache->data = NULL;
+    cache->count = 0;
+}
+
+/***********************************************************************
+ *           get_image_relocations
+ *
+ * Check whether an image mapped away from its preferred base can be relocated
+ * through the cache, and return its relocation directory.
+ */
+static const IMAGE_DATA_DIRECTORY *get_image_relocations( struct file_view *view, IMAGE_NT_HEADERS **ret )
+{
+    IMAGE_NT_HEADERS *nt = (IMAGE_NT_HEADERS *)((char *)view->base + ((IMAGE_DOS_HEADER *)view->base)->e_lfanew);
+    const IMAGE_DATA_DIRECTORY *relocs = &nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+    const IMAGE_SECTION_HEADER *sec;
+    unsigned int i;
+
+    if (nt->OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR_MAGIC) return NULL;
+    if ((char *)view->base == (char *)nt->OptionalHeader.ImageBase) return NULL;
+    if (!(nt->FileHeader.Characteristics & IMAGE_FILE_DLL)) return NULL;
+    if (nt->FileHeader.Characteristics & IMAGE_FILE_RELOCS_STRIPPED) return NULL;
+    if (!relocs->Size || !relocs->VirtualAddress) return NULL;
+    if (relocs->VirtualAddress >= view->size || relocs->Size > view->size - relocs->VirtualAddress) return NULL;
+
+    /* shared sections must stay mapped from the shared file */
+    sec = (const IMAGE_SECTION_HEADER *)((char *)&nt->OptionalHeader + nt->FileHeader.SizeOfOptionalHeader);
+    for (i = 0; i < nt->FileHeader.NumberOfSections; i++)
+        if ((sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) && (sec[i].Characteristics & IMAGE_SCN_MEM_WRITE))
+            return NULL;
+
+    *ret = nt;
+    return relocs;
+}
+
+/***********************************************************************
+ *           open_reloc_cache
+ *
+ * Open and validate the cache file for an image mapped at "base".
+ * virtual_mutex must not be held, this does file I/O.
+ */
+static BOOL open_reloc_cache( struct reloc_cache *cache, void *base, size_t size )
+{
+    struct reloc_cache_header header;
+    struct stat cache_st;
+    unsigned int i;
+    int fd;
+
+    if (!(cache->name = malloc( strlen( cache->dir ) + 64 ))) return FALSE;
+    sprintf( cache->name, "%s/%llx-%llx-%lx", cache->dir, (unsigned long long)cache->st.st_dev,
+             (unsigned long long)cache->st.st_ino, (unsigned long)base );
+
+    if ((fd = open( cache->name, O_RDONLY )) == -1) return FALSE;
+    if (fstat( fd, &cache_st ) == -1) goto failed;
+
+    if (pread( fd, &header, sizeof(header), 0 ) != sizeof(header)) goto failed;
+    if (header.magic != RELOC_CACHE_MAGIC || header.version != RELOC_CACHE_VERSION) goto failed;
+    if (header.dev != cache->st.st_dev || header.ino != cache->st.st_ino || header.size != cache->st.st_size ||
+        header.mtime != cache->st.st_mtime || header.base != (ULONG_PTR)base ||
+        header.image_size != size || !header.count || header.count > size >> page_shift)
+        goto failed;
+
+    if (!(cache->rvas = malloc( header.count * sizeof(*cache->rvas) ))) goto failed;
+    if (pread( fd, cache->rvas, header.count * sizeof(*cache->rvas), sizeof(header) )
+            != header.count * sizeof(*cache->rvas))
+        goto failed;
+    for (i = 0; i < header.count; i++)
+        if ((cache->rvas[i] & page_mask) || cache->rvas[i] >= size ||
+            (i && cache->rvas[i] <= cache->rvas[i - 1])) goto failed;
+
+    cache->data_pos = ROUND_SIZE( 0, sizeof(header) + header.count * sizeof(*cache->rvas) );
+    if (cache_st.st_size < cache->data_pos + ((off_t)header.count << page_shift)) goto failed;
+
+    /* the modification time orders the files for eviction */
+    utimes( cache->name, NULL );
+    cache->fd = fd;
+    cache->count = header.count;
+    return TRUE;
+
+failed:
+    close( fd );
+    free( cache->rvas );
+    cache->rvas = NULL;
+    return FALSE;
+}
+
+/***********************************************************************
+ *           map_reloc_cache
+ *
+ * Map the cached relocated pages of an image copy-on-write over the view.
+ * virtual_mutex must be held by caller. On failure some pages may already
+ * have been replaced, so the view must not be used any more.
+ */
+static BOOL map_reloc_cache( struct file_view *view, struct reloc_cache *cache )
+{
+    unsigned int i, start, count;
+
+    /* map runs of consecutive pages with a single mmap */
+    for (i = start = 0; i < cache->count; i = start = start + count)
+    {
+        char *addr = (char *)view->base + cache->rvas[start];
+
+        for (count = 1; start + count < cache->count; count++)
+            if (cache->rvas[start + count] != cache->rvas[start] + (count << page_shift)) break;
+        if (mmap( addr, count << page_shift, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE, cache->fd,
+                  cache->data_pos + ((off_t)start << page_shift) ) == MAP_FAILED)
+        {
+            ERR_(module)( "failed to map cached pages from %s\n", cache->name );
+            return FALSE;
+        }
+        mprotect_range( addr, count << page_shift, 0, 0 );
+    }
+    TRACE_(module)( "mapped %u cached relocated pages from %s\n", cache->count, cache->name );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           apply_relocations
+ *
+ * Apply the base relocations of an image and keep a copy of the modified
+ * pages for the cache. Returns FALSE if the image was left untouched.
+ * virtual_mutex must be held by caller.
+ */
+static BOOL apply_relocations( struct file_view *view, IMAGE_NT_HEADERS *nt,
+                               const IMAGE_DATA_DIRECTORY *relocs, struct reloc_cache *cache )
+{
+    const IMAGE_BASE_RELOCATION *rel, *end;
+    char *ptr = view->base;
+    INT_PTR delta = ptr - (char *)nt->OptionalHeader.ImageBase;
+    unsigned int *rvas, i, count = 0;
+    BOOL ret = FALSE;
+
+    if (!(rvas = malloc( (view->size >> page_shift) * sizeof(*rvas) ))) return FALSE;
+
+    /* the section protections are already set, lift them while relocating */
+    mprotect_exec( ptr, view->size, PROT_READ | PROT_WRITE );
+
+    /* validate the blocks and collect the pages they modify before touching anything */
+    rel = (const IMAGE_BASE_RELOCATION *)(ptr + relocs->VirtualAddress);
+    end = (const IMAGE_BASE_RELOCATION *)(ptr + relocs->VirtualAddress + relocs->Size);
+    while (rel < end - 1 && rel->SizeOfBlock)
+    {
+        const USHORT *entry = (const USHORT *)(rel + 1);
+        const USHORT *last = (const USHORT *)((const char *)rel + rel->SizeOfBlock);
+        unsigned int page;
+
+        if (rel->SizeOfBlock < sizeof(*rel) || (const char *)last > (const char *)end) goto failed;
+        if (rel->VirtualAddress >= view->size) goto failed;
+        for ( ; entry < last; entry++)
+        {
+            unsigned int first = (rel->VirtualAddress + (*entry & 0xfff)) & ~page_mask;
+            unsigned int final = (rel->VirtualAddress + (*entry & 0xfff) + sizeof(INT_PTR) - 1) & ~page_mask;
+
+            switch (*entry >> 12)
+            {
+            case IMAGE_REL_BASED_ABSOLUTE:
+                continue;
+            case IMAGE_REL_BASED_HIGH:
+            case IMAGE_REL_BASED_LOW:
+            case IMAGE_REL_BASED_HIGHLOW:
+#ifdef _WIN64
+            case IMAGE_REL_BASED_DIR64:
+#endif
+                break;
+            default:
+                goto failed;
+            }
+            /* an entry at the end of the block may spill over into the next page */
+            if (final >= view->size) goto failed;
+            for (page = first; page <= final; page += page_size)
+            {
+                if (count && rvas[count - 1] == page) continue;
+                for (i = count; i > 0 && rvas[i - 1] > page; i--) ;
+                if (i && rvas[i - 1] == page) continue;
+                memmove( rvas + i + 1, rvas + i, (count - i) * sizeof(*rvas) );
+                rvas[i] = page;
+                count++;
+            }
+        }
+        rel = (const IMAGE_BASE_RELOCATION *)last;
+    }
+    if (!count) goto done;
+
+    TRACE_(module)( "relocating %p from %p, %u pages\n", ptr, (void *)nt->OptionalHeader.ImageBase, count );
+    rel = (const IMAGE_BASE_RELOCATION *)(ptr + relocs->VirtualAddress);
+    while (rel < end - 1 && rel->SizeOfBlock) rel = process_relocation_block( ptr, rel, delta );
+    ret = TRUE;
+    if ((cache->data = malloc( (size_t)count << page_shift )))
+    {
+        for (i = 0; i < count; i++) memcpy( cache->data + ((size_t)i << page_shift), ptr + rvas[i], page_size );
+        cache->rvas = rvas;
+        cache->count = count;
+        rvas = NULL;
+    }
+    goto done;
+
+failed:
+    WARN_(module)( "unsupported relocations in image at %p, not relocating\n", ptr );
+done:
+    mprotect_range( ptr, view->size, 0, 0 );
+    free( rvas );
+    return ret;
+}
+
+/***********************************************************************
+ *           relocate_image
+ *
+ * Apply the base relocations of a dll mapped away from its preferred base,
+ * using the relocation cache when possible. The cache file is opened with
+ * virtual_mutex temporarily released. Returns FALSE if the cache could only
+ * partly be mapped, in which case the view must be discarded. When the
+ * relocations are left to the PE loader the view is left untouched.
+ */
+static BOOL relocate_image( struct file_view *view, struct reloc_cache *cache, sigset_t *sigset )
+{
+    const IMAGE_DATA_DIRECTORY *relocs;
+    IMAGE_NT_HEADERS *nt;
+    void *image_base;
+    BOOL loaded;
+
+    if (!cache->dir || !(relocs = get_image_relocations( view, &nt ))) return TRUE;
+
+    /* the view isn't returned to the application yet, so nothing else uses it */
+    server_leave_uninterrupted_section( &virtual_mutex, sigset );
+    loaded = open_reloc_cache( cache, view->base, view->size );
+    server_enter_uninterrupted_section( &virtual_mutex, sigset );
+
+    if (loaded)
+    {
+        if (!map_reloc_cache( view, cache )) return FALSE;
+    }
+    else if (!apply_relocations( view, nt, relocs, cache )) return TRUE;
+
+    /* make the PE loader skip its own relocation pass */
+    image_base = &nt->OptionalHeader.ImageBase;
+    mprotect_exec( ROUND_ADDR( image_base, page_mask ), page_size, PROT_READ | PROT_WRITE );
+    nt->OptionalHeader.ImageBase = (ULONG_PTR)view->base;
+    mprotect_range( image_base, sizeof(nt->OptionalHeader.ImageBase), 0, 0 );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           trim_reloc_cache
+ *
+ * Delete the least recently used cache files until the cache fits in
+ * RELOC_CACHE_MAX_SIZE.
+ */
+static void trim_reloc_cache( const char *dir_name )
+{
+    struct cache_file
+    {
+        char   name[64];
+        off_t  size;
+        time_t mtime;
+    } *files = NULL, *new_files, tmp;
+    unsigned int i, j, count = 0, alloc = 0;
+    size_t path_size = strlen( dir_name ) + sizeof(files->name) + 1;
+    struct dirent *de;
+    struct stat st;
+    off_t total = 0;
+    char *path;
+    DIR *dir;
+
+    if (!(path = malloc( path_size ))) return;
+    if (!(dir = opendir( dir_name )))
+    {
+        free( path );
+        return;
+    }
+    while ((de = readdir( dir )))
+    {
+        if (de->d_name[0] == '.' || strlen( de->d_name ) >= sizeof(files->name)) continue;
+        snprintf( path, path_size, "%s/%s", dir_name, de->d_name );
+        if (stat( path, &st ) == -1 || !S_ISREG( st.st_mode )) continue;
+        if (count == alloc)
+        {
+            alloc = max( 64, alloc * 2 );
+            if (!(new_files = realloc( files, alloc * sizeof(*files) ))) break;
+            files = new_files;
+        }
+        strcpy( files[count].name, de->d_name );
+        files[count].size = st.st_size;
+        files[count].mtime = st.st_mtime;
+        total += st.st_size;
+        count++;
+    }
+    closedir( dir );
+
+    if (total > RELOC_CACHE_MAX_SIZE)
+    {
+        /* oldest first */
+        for (i = 1; i < count; i++)
+        {
+            tmp = files[i];
+            for (j = i; j > 0 && files[j - 1].mtime > tmp.mtime; j--) files[j] = files[j - 1];
+            files[j] = tmp;
+        }
+        /* leave some room so that this doesn't happen on every store */
+        for (i = 0; i < count && total > RELOC_CACHE_MAX_SIZE / 4 * 3; i++)
+        {
+            snprintf( path, path_size, "%s/%s", dir_name, files[i].name );
+            if (!unlink( path )) total -= files[i].size;
+        }
+        TRACE_(module)( "evicted %u files from %s\n", i, dir_name );
+    }
+    free( files );
+    free( path );
+}
+
+/***********************************************************************
+ *           save_reloc_cache
+ *
+ * Store the relocated pages of an image in the cache.
+ * virtual_mutex must not be held, this does file I/O.
+ */
+static void save_reloc_cache( const struct reloc_cache *cache, void *base, size_t size )
+{
+    struct reloc_cache_header header;
+    char *tmp_name;
+    size_t rvas_size = cache->count * sizeof(*cache->rvas);
+    size_t data_size = (size_t)cache->count << page_shift;
+    off_t data_pos = ROUND_SIZE( 0, sizeof(header) + rvas_size );
+    int fd;
+
+    if (data_pos + data_size > RELOC_CACHE_MAX_SIZE / 4) return;
+    if (!(tmp_name = malloc( strlen( cache->name ) + 16 ))) return;
+    sprintf( tmp_name, "%s.%x", cache->name, getpid() );
+    if ((fd = open( tmp_name, O_WRONLY | O_CREAT | O_EXCL, 0666 )) == -1) goto done;
+
+    header.magic      = RELOC_CACHE_MAGIC;
+    header.version    = RELOC_CACHE_VERSION;
+    header.dev        = cache->st.st_dev;
+    header.ino        = cache->st.st_ino;
+    header.size       = cache->st.st_size;
+    header.mtime      = cache->st.st_mtime;
+    header.base       = (ULONG_PTR)base;
+    header.image_size = size;
+    header.count      = cache->count;
+
+    if (pwrite( fd, &header, sizeof(header), 0 ) != sizeof(header) ||
+        pwrite( fd, cache->rvas, rvas_size, sizeof(header) ) != rvas_size ||
+        pwrite( fd, cache->data, data_size, data_pos ) != data_size)
+    {
+        close( fd );
+        unlink( tmp_name );
+        goto done;
+    }
+
+    close( fd );
+    if (!rename( tmp_name, cache->name ))
+    {
+        TRACE_(module)( "stored %u relocated pages in %s\n", cache->count, cache->name );
+        trim_reloc_cache( cache->dir );
+    }
+    else unlink( tmp_name );
+
+done:
+    free( tmp_name );
+}
+
+
 /***********************************************************************
  *           map_image_into_view
  *
@@ -2532,6 +2964,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     int unix_fd = -1, needs_close;
     int shared_fd = -1, shared_needs_close = 0;
     SIZE_T size = image_info->map_size;
+    struct reloc_cache cache = { NULL };
     struct file_view *view;
     NTSTATUS status;
     sigset_t sigset;
@@ -2547,6 +2980,12 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
         return status;
     }
 
+    cache.fd = -1;
+    if (!(image_info->image_flags & IMAGE_FLAGS_ImageMappedFlat) && (cache.dir = get_reloc_cache_dir()) &&
+        fstat( unix_fd, &cache.st ) == -1)
+        cache.dir = NULL;
+
+retry:
     status = STATUS_INVALID_PARAMETER;
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
@@ -2561,6 +3000,16 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
 
     status = map_image_into_view( view, filename, unix_fd, base, image_info->header_size,
                                   image_info->image_flags, shared_fd, needs_close );
+    if (status == STATUS_SUCCESS && !relocate_image( view, &cache, &sigset ))
+    {
+        /* some pages may already have been replaced from the cache, never
+         * relocate them again but start over without the cache */
+        delete_view( view );
+        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        free_reloc_cache( &cache );
+        cache.dir = NULL;
+        goto retry;
+    }
     if (status == STATUS_SUCCESS)
     {
         SERVER_START_REQ( map_view )
@@ -2584,6 +3033,8 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
 
 done:
     server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    if (status >= 0 && cache.data) save_reloc_cache( &cache, *addr_ptr, *size_ptr );
+    free_reloc_cache( &cache );
     if (needs_close) close( unix_fd );
     if (shared_needs_close) close( shared_fd );
     return status;
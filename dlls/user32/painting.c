@@ -462,6 +462,7 @@ static INT release_dc( HWND hwnd, HDC hdc, BOOL end_paint )
 
     TRACE("%p %p\n", hwnd, hdc );
 
+    GdiFlush();
     USER_Lock();
     dce = (struct dce *)GetDCHook( hdc, NULL );
     if (dce && dce->count && dce->hwnd)
@@ -1506,6 +1507,7 @@ static INT scroll_window( HWND hwnd, INT dx, INT dy, const RECT *rect, const REC
         hDC = GetDCEx( hwnd, 0, dcxflags);
         if (hDC)
         {
+            GdiFlush();
             NtUserScrollDC( hDC, dx, dy, &rc, &cliprc, hrgnUpdate, rcUpdate );
 
             ReleaseDC( hwnd, hDC );
@@ -1606,6 +1608,17 @@ static INT scroll_window( HWND hwnd, INT dx, INT dy, const RECT *rect, const REC
 }
 
 
+/*************************************************************************
+ *		ScrollDC (USER32.@)
+ */
+BOOL WINAPI ScrollDC( HDC hdc, INT dx, INT dy, const RECT *scroll, const RECT *clip,
+                      HRGN ret_update_rgn, RECT *update_rect )
+{
+    /* the batched calls must be executed before the bits are moved */
+    GdiFlush();
+    return NtUserScrollDC( hdc, dx, dy, scroll, clip, ret_update_rgn, update_rect );
+}
+
 /*************************************************************************
  *		ScrollWindowEx (USER32.@)
  *
@@ -749,6 +749,7 @@ void flush_window_surfaces( BOOL idle )
     DWORD now;
     struct window_surface *surface;
 
+    GdiFlush();
     EnterCriticalSection( &surfaces_section );
     now = GetTickCount();
     if (idle) last_idle = now;
@@ -528,6 +528,35 @@ COLORREF CDECL nulldrv_GetPixel( PHYSDEV dev, INT x, INT y )
 }
 
 
+static BOOL patblt( DC *dc, INT left, INT top, INT width, INT height, DWORD rop )
+{
+    struct bitblt_coords dst;
+    BOOL ret;
+
+    dst.log_x      = left;
+    dst.log_y      = top;
+    dst.log_width  = width;
+    dst.log_height = height;
+    dst.layout     = dc->attr->layout;
+    if (rop & NOMIRRORBITMAP)
+    {
+        dst.layout |= LAYOUT_BITMAPORIENTATIONPRESERVED;
+        rop &= ~NOMIRRORBITMAP;
+    }
+    ret = !get_vis_rectangles( dc, &dst, NULL, NULL );
+
+    TRACE("dst %p log=%d,%d %dx%d phys=%d,%d %dx%d vis=%s  rop=%06x\n",
+          dc->hSelf, dst.log_x, dst.log_y, dst.log_width, dst.log_height,
+          dst.x, dst.y, dst.width, dst.height, wine_dbgstr_rect(&dst.visrect), rop );
+
+    if (!ret)
+    {
+        PHYSDEV physdev = GET_DC_PHYSDEV( dc, pPatBlt );
+        ret = physdev->funcs->pPatBlt( physdev, &dst, rop );
+    }
+    return ret;
+}
+
 /***********************************************************************
  *           NtGdiPatBlt    (win32u.@)
  */
@@ -539,33 +568,47 @@ BOOL WINAPI NtGdiPatBlt( HDC hdc, INT left, INT top, INT width, INT height, DWOR
     if (rop_uses_src( rop )) return FALSE;
     if ((dc = get_dc_ptr( hdc )))
     {
-        struct bitblt_coords dst;
-
         update_dc( dc );
+        ret = patblt( dc, left, top, width, height, rop );
+        release_dc_ptr( dc );
+    }
+    return ret;
+}
 
-        dst.log_x      = left;
-        dst.log_y      = top;
-        dst.log_width  = width;
-        dst.log_height = height;
-        dst.layout     = dc->attr->layout;
-        if (rop & NOMIRRORBITMAP)
-        {
-            dst.layout |= LAYOUT_BITMAPORIENTATIONPRESERVED;
-            rop &= ~NOMIRRORBITMAP;
-        }
-        ret = !get_vis_rectangles( dc, &dst, NULL, NULL );
 
-        TRACE("dst %p log=%d,%d %dx%d phys=%d,%d %dx%d vis=%s  rop=%06x\n",
-              hdc, dst.log_x, dst.log_y, dst.log_width, dst.log_height,
-              dst.x, dst.y, dst.width, dst.height, wine_dbgstr_rect(&dst.visrect), rop );
+/***********************************************************************
+ *           NtGdiPolyPatBlt    (win32u.@)
+ *
+ * Fill a list of rectangles, the DC only needs to be looked up once.
+ */
+BOOL WINAPI NtGdiPolyPatBlt( HDC hdc, DWORD rop, const POLYPATBLT *rects, DWORD count, DWORD mode )
+{
+    HBRUSH brush, prev_brush;
+    DC *dc;
+    DWORD i;
+    BOOL ret = TRUE;
 
-        if (!ret)
+    TRACE( "%p %06x %p %u %u\n", hdc, rop, rects, count, mode );
+
+    if (rop_uses_src( rop )) return FALSE;
+    if (!(dc = get_dc_ptr( hdc ))) return FALSE;
+    update_dc( dc );
+
+    prev_brush = dc->hBrush;
+    for (i = 0; i < count; i++)
+    {
+        brush = rects[i].hBrush ? rects[i].hBrush : prev_brush;
+        if (brush != dc->hBrush && !NtGdiSelectBrush( hdc, brush ))
         {
-            PHYSDEV physdev = GET_DC_PHYSDEV( dc, pPatBlt );
-            ret = physdev->funcs->pPatBlt( physdev, &dst, rop );
+            ret = FALSE;
+            continue;
         }
-        release_dc_ptr( dc );
+        if (!patblt( dc, rects[i].nXLeft, rects[i].nYLeft, rects[i].nWidth, rects[i].nHeight, rop ))
+            ret = FALSE;
     }
+    if (dc->hBrush != prev_brush) NtGdiSelectBrush( hdc, prev_brush );
+
+    release_dc_ptr( dc );
     return ret;
 }
 
@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -470,6 +473,210 @@ static int get_overlap( const dib_info *dst, const RECT *dst_rect,
     return ret;
 }
 
+/* Large copies and blends are split into horizontal bands that are processed
+ * in parallel by a small pool of helper threads, the calling thread taking its
+ * share of the bands too. The helpers are plain pthreads: they only ever run
+ * the primitive functions, which don't depend on any Win32 thread state.
+ * Since they can't handle exceptions, they are only used on bits allocated by
+ * win32u itself, i.e. DDBs and window surfaces. DIB sections and application
+ * supplied bits may be write-watched or protected and are always processed
+ * serially by the calling thread, however large they are. */
+
+#define BAND_MIN_PIXELS (256 * 1024)  /* smallest rectangle worth splitting */
+#define BAND_MIN_ROWS   32            /* smallest band height */
+#define MAX_BANDS       8
+
+struct band_job
+{
+    int         refcount; /* protected by band_mutex */
+    void      (*func)( const RECT *band, void *context );
+    RECT        rect;
+    int         count;    /* total number of bands */
+    int         next;     /* next band to process */
+    int         pending;  /* bands that haven't completed yet */
+    char        context[1];
+};
+
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t band_once = PTHREAD_ONCE_INIT;
+static struct band_job *band_job;  /* job with bands left to start, protected by band_mutex */
+static int band_threads;           /* number of helper threads */
+
+static void run_band( struct band_job *job, int index )
+{
+    const RECT *rect = &job->rect;
+    int height = rect->bottom - rect->top;
+    RECT band;
+
+    band.left   = rect->left;
+    band.right  = rect->right;
+    band.top    = rect->top + height * index / job->count;
+    band.bottom = rect->top + height * (index + 1) / job->count;
+    job->func( &band, job->context );
+}
+
+/* must be called with band_mutex held */
+static void release_band_job( struct band_job *job )
+{
+    if (!--job->refcount) free( job );
+}
+
+/* process bands until none is left; must be called with band_mutex held */
+static void process_bands( struct band_job *job )
+{
+    int index;
+
+    while (job->next < job->count)
+    {
+        index = job->next++;
+        /* let another job start as soon as all bands are handed out, so that
+         * a caller that never comes back doesn't block the helpers forever */
+        if (job->next == job->count && band_job == job) band_job = NULL;
+        pthread_mutex_unlock( &band_mutex );
+        run_band( job, index );
+        pthread_mutex_lock( &band_mutex );
+        if (!--job->pending) pthread_cond_broadcast( &band_done_cond );
+    }
+}
+
+static void *band_thread( void *arg )
+{
+    struct band_job *job;
+
+    pthread_mutex_lock( &band_mutex );
+    for (;;)
+    {
+        while (!(job = band_job)) pthread_cond_wait( &band_start_cond, &band_mutex );
+        job->refcount++;
+        process_bands( job );
+        release_band_job( job );
+    }
+    return NULL;
+}
+
+static void init_band_threads(void)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    sigset_t sigset, old_sigset;
+    long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    int i, count = min( cpus, MAX_BANDS ) - 1;
+
+    if (count <= 0) return;
+
+    /* signals are for the Win32 threads to handle */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    pthread_attr_setstacksize( &attr, 256 * 1024 );
+    for (i = 0; i < count; i++)
+        if (pthread_create( &thread, &attr, band_thread, NULL )) break;
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+
+    band_threads = i;
+    TRACE( "using %d helper threads\n", band_threads );
+}
+
+/* call func on a rectangle, possibly split in bands processed in parallel
+ * the context is copied, so it must not point to anything on the caller stack */
+static void run_in_bands( const dib_info *dst, const dib_info *src, const RECT *rect,
+                          void (*func)( const RECT *, void * ), void *context, size_t size )
+{
+    int width = rect->right - rect->left, height = rect->bottom - rect->top;
+    struct band_job *job;
+    int count;
+
+    if (width * height < BAND_MIN_PIXELS || height < 2 * BAND_MIN_ROWS ||
+        !dst->private_bits || (src && !src->private_bits))
+    {
+        func( rect, context );
+        return;
+    }
+
+    pthread_once( &band_once, init_band_threads );
+
+    count = min( min( band_threads + 1, height / BAND_MIN_ROWS ), MAX_BANDS );
+    if (count <= 1 || !(job = malloc( offsetof( struct band_job, context[size] ))))
+    {
+        func( rect, context );
+        return;
+    }
+
+    job->refcount = 1;
+    job->func     = func;
+    job->rect     = *rect;
+    job->count    = count;
+    job->next     = 0;
+    job->pending  = count;
+    memcpy( job->context, context, size );
+
+    pthread_mutex_lock( &band_mutex );
+    if (band_job)  /* helpers already busy with another job */
+    {
+        pthread_mutex_unlock( &band_mutex );
+        free( job );
+        func( rect, context );
+        return;
+    }
+    band_job = job;
+    pthread_cond_broadcast( &band_start_cond );
+    process_bands( job );
+    while (job->pending) pthread_cond_wait( &band_done_cond, &band_mutex );
+    release_band_job( job );
+    pthread_mutex_unlock( &band_mutex );
+}
+
+struct copy_band_params
+{
+    dib_info dst;
+    dib_info src;
+    POINT    offset;  /* src origin relative to dst origin */
+    int      rop2;
+};
+
+static void copy_band( const RECT *band, void *context )
+{
+    struct copy_band_params *params = context;
+    POINT origin;
+
+    origin.x = band->left + params->offset.x;
+    origin.y = band->top  + params->offset.y;
+    params->dst.funcs->copy_rect( &params->dst, band, &params->src, &origin, params->rop2, 0 );
+}
+
+struct solid_band_params
+{
+    dib_info dst;
+    DWORD    and;
+    DWORD    xor;
+};
+
+static void solid_band( const RECT *band, void *context )
+{
+    struct solid_band_params *params = context;
+
+    params->dst.funcs->solid_rects( &params->dst, 1, band, params->and, params->xor );
+}
+
+struct blend_band_params
+{
+    dib_info      dst;
+    dib_info      src;
+    POINT         offset;
+    BLENDFUNCTION blend;
+};
+
+static void blend_band( const RECT *band, void *context )
+{
+    struct blend_band_params *params = context;
+
+    params->dst.funcs->blend_rects( &params->dst, 1, band, &params->src, &params->offset, params->blend );
+}
+
 static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                         const struct clipped_rects *clipped_rects, INT rop2 )
 {
@@ -496,7 +703,15 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     case R2_WHITE: xor = ~0u;
         /* fall through */
     case R2_BLACK:
-        dst->funcs->solid_rects( dst, count, rects, and, xor );
+    {
+        struct solid_band_params params;
+
+        params.dst = *dst;
+        params.and = and;
+        params.xor = xor;
+        for (i = 0; i < count; i++)
+            run_in_bands( dst, NULL, &rects[i], solid_band, &params, sizeof(params) );
+    }
         /* fall through */
     case R2_NOP:
         return;
@@ -545,6 +760,18 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
             }
         }
     }
+    else if (!overlap)  /* no overlap, bands can be copied in any order */
+    {
+        struct copy_band_params params;
+
+        params.dst      = *dst;
+        params.src      = *src;
+        params.offset.x = src_rect->left - dst_rect->left;
+        params.offset.y = src_rect->top  - dst_rect->top;
+        params.rop2     = rop2;
+        for (i = 0; i < count; i++)
+            run_in_bands( dst, src, &rects[i], copy_band, &params, sizeof(params) );
+    }
     else  /* left to right, top to bottom */
     {
         for (i = 0; i < count; i++)
@@ -588,14 +815,19 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
-    POINT offset;
     struct clipped_rects clipped_rects;
+    struct blend_band_params params;
+    int i;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
 
-    offset.x = src_rect->left - dst_rect->left;
-    offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+    params.dst      = *dst;
+    params.src      = *src;
+    params.offset.x = src_rect->left - dst_rect->left;
+    params.offset.y = src_rect->top  - dst_rect->top;
+    params.blend    = blend;
+    for (i = 0; i < clipped_rects.count; i++)
+        run_in_bands( dst, src, &clipped_rects.rects[i], blend_band, &params, sizeof(params) );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
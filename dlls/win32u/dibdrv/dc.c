@@ -91,6 +91,7 @@ static void init_dib_info(dib_info *dib, const BITMAPINFOHEADER *bi, int stride,
     dib->bits.is_copy = FALSE;
     dib->bits.free    = NULL;
     dib->bits.param   = NULL;
+    dib->private_bits = FALSE;
 
     if(dib->height < 0) /* top-down */
     {
@@ -177,6 +178,7 @@ BOOL init_dib_info_from_bitmapobj(dib_info *dib, BITMAPOBJ *bmp)
 
         get_ddb_bitmapinfo( bmp, &info );
         init_dib_info_from_bitmapinfo( dib, &info, bmp->dib.dsBm.bmBits );
+        dib->private_bits = TRUE;
     }
     else init_dib_info( dib, &bmp->dib.dsBmih, bmp->dib.dsBm.bmWidthBytes,
                         bmp->dib.dsBitfields, bmp->color_table, bmp->dib.dsBm.bmBits );
@@ -735,6 +737,8 @@ struct windrv_physdev
     struct dibdrv_physdev *dibdrv;
     struct window_surface *surface;
     DWORD                  start_ticks;
+    RECT                   saved_bounds;
+    UINT                   lock_count;
 };
 
 static const struct gdi_dc_funcs window_driver;
@@ -746,13 +750,37 @@ static inline struct windrv_physdev *get_windrv_physdev( PHYSDEV dev )
 
 static inline void lock_surface( struct windrv_physdev *dev )
 {
+    RECT *bounds = dev->dibdrv->bounds;
+
     /* gdi_lock should not be locked */
     dev->surface->funcs->lock( dev->surface );
-    if (is_rect_empty( dev->dibdrv->bounds )) dev->start_ticks = NtGetTickCount();
+    if (!dev->surface->funcs->add_dirty_rect)
+    {
+        if (is_rect_empty( bounds )) dev->start_ticks = NtGetTickCount();
+    }
+    else if (!dev->lock_count++)
+    {
+        if (is_rect_empty( bounds )) dev->start_ticks = NtGetTickCount();
+        /* collect the bounds of this operation separately so that the driver
+         * can track dirty areas more precisely than a single bounding box */
+        dev->saved_bounds = *bounds;
+        reset_bounds( bounds );
+    }
+}
+
+static inline void add_dirty_bounds( struct windrv_physdev *dev )
+{
+    RECT *bounds = dev->dibdrv->bounds, rect;
+
+    if (!dev->surface->funcs->add_dirty_rect || --dev->lock_count) return;
+    rect = *bounds;
+    *bounds = dev->saved_bounds;
+    if (!is_rect_empty( &rect )) dev->surface->funcs->add_dirty_rect( dev->surface, &rect );
 }
 
 static inline void unlock_surface( struct windrv_physdev *dev )
 {
+    add_dirty_bounds( dev );
     dev->surface->funcs->unlock( dev->surface );
     if (NtGetTickCount() - dev->start_ticks > FLUSH_PERIOD) dev->surface->funcs->flush( dev->surface );
 }
@@ -793,6 +821,7 @@ void dibdrv_set_window_surface( DC *dc, struct window_surface *surface )
         dibdrv = physdev->dibdrv;
         bits = surface->funcs->get_info( surface, info );
         init_dib_info_from_bitmapinfo( &dibdrv->dib, info, bits );
+        dibdrv->dib.private_bits = TRUE;
         dibdrv->dib.rect = dc->attr->vis_rect;
         offset_rect( &dibdrv->dib.rect, -dc->device_rect.left, -dc->device_rect.top );
         dibdrv->bounds = surface->funcs->get_bounds( surface );
@@ -960,6 +989,7 @@ static DWORD CDECL windrv_GetImage( PHYSDEV dev, BITMAPINFO *info,
     {
         /* use the freeing callback to unlock the surface */
         assert( !bits->free );
+        add_dirty_bounds( physdev );
         bits->free = unlock_bits_surface;
         bits->param = physdev->surface;
     }
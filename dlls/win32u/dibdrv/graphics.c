@@ -47,6 +47,21 @@ enum glyph_type
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
 
+/* glyph bitmaps of a font are packed together in chunks of growing size */
+#define GLYPH_CHUNK_MIN_SIZE   0x1000
+#define GLYPH_CHUNK_MAX_SIZE   0x10000
+
+/* memory used by the glyphs of unused fonts before they get evicted */
+#define GLYPH_CACHE_BUDGET     (16 * 1024 * 1024)
+
+struct glyph_chunk
+{
+    struct glyph_chunk *next;
+    SIZE_T              size;
+    SIZE_T              used;
+    BYTE                data[1];
+};
+
 struct cached_font
 {
     struct list           entry;
@@ -55,10 +70,15 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    struct glyph_chunk   *chunks;     /* glyph storage, protected by font_cache_lock */
+    SIZE_T                chunk_size; /* total size of the chunks */
+    LONG                  hits;       /* glyph lookups found in the cache */
+    LONG                  misses;     /* glyph lookups that needed rendering */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
 static struct list font_cache = LIST_INIT( font_cache );
+static SIZE_T font_cache_size;  /* total size of the glyph chunks */
 
 static pthread_mutex_t font_cache_lock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -551,10 +571,31 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+/* must be called with font_cache_lock held */
+static void free_cached_font( struct cached_font *font )
+{
+    struct glyph_chunk *chunk, *next;
+    UINT i, j;
+
+    TRACE( "%p: %d hits, %d misses, %lu bytes\n", font, font->hits, font->misses, font->chunk_size );
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+            free( font->glyphs[i][j] );
+    for (chunk = font->chunks; chunk; chunk = next)
+    {
+        next = chunk->next;
+        free( chunk );
+    }
+    font_cache_size -= font->chunk_size;
+    list_remove( &font->entry );
+    free( font );
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
-    struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct cached_font font, *ptr, *next;
+    UINT i = 0;
 
     NtGdiExtGetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -578,29 +619,19 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
             list_remove( &ptr->entry );
             goto done;
         }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
+        if (!ptr->ref) i++;
     }
 
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
+    /* keep at least 5 of the most-recently used fonts around, as long as they fit in the budget */
+    LIST_FOR_EACH_ENTRY_SAFE_REV( ptr, next, &font_cache, struct cached_font, entry )
     {
-        ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    free( ptr->glyphs[i][j][k] );
-                free( ptr->glyphs[i][j] );
-            }
-        }
-        list_remove( &ptr->entry );
+        if (i <= 5 && font_cache_size <= GLYPH_CACHE_BUDGET) break;
+        if (ptr->ref) continue;
+        free_cached_font( ptr );
+        i--;
     }
-    else if (!(ptr = malloc( sizeof(*ptr) )))
+
+    if (!(ptr = malloc( sizeof(*ptr) )))
     {
         pthread_mutex_unlock( &font_cache_lock );
         return NULL;
@@ -608,6 +639,9 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->chunks = NULL;
+    ptr->chunk_size = 0;
+    ptr->hits = ptr->misses = 0;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
     list_add_head( &font_cache, &ptr->entry );
@@ -621,6 +655,36 @@ void release_cached_font( struct cached_font *font )
     if (font) InterlockedDecrement( &font->ref );
 }
 
+static struct cached_glyph *alloc_cached_glyph( struct cached_font *font, SIZE_T size )
+{
+    struct glyph_chunk *chunk;
+    SIZE_T chunk_size;
+    void *ret;
+
+    size = (size + 7) & ~7;
+    pthread_mutex_lock( &font_cache_lock );
+    if (!(chunk = font->chunks) || chunk->size - chunk->used < size)
+    {
+        chunk_size = chunk ? min( chunk->size * 2, GLYPH_CHUNK_MAX_SIZE ) : GLYPH_CHUNK_MIN_SIZE;
+        chunk_size = max( chunk_size, size );
+        if (!(chunk = malloc( FIELD_OFFSET( struct glyph_chunk, data[chunk_size] ))))
+        {
+            pthread_mutex_unlock( &font_cache_lock );
+            return NULL;
+        }
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = font->chunks;
+        font->chunks = chunk;
+        font->chunk_size += chunk_size;
+        font_cache_size += chunk_size;
+    }
+    ret = chunk->data + chunk->used;
+    chunk->used += size;
+    pthread_mutex_unlock( &font_cache_lock );
+    return ret;
+}
+
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
                                               struct cached_glyph *glyph )
 {
@@ -634,17 +698,13 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
         struct cached_glyph **ptr;
 
         ptr = calloc( 1, GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr) );
-        if (!ptr)
-        {
-            free( glyph );
-            return NULL;
-        }
+        if (!ptr) return NULL;
         if (InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page], ptr, NULL ))
             free( ptr );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
+    /* if another thread won the race, our copy simply stays unused in the chunk */
     if (!ret) ret = glyph;
-    else free( glyph );
     return ret;
 }
 
@@ -678,27 +738,50 @@ static inline void get_text_bkgnd_masks( DC *dc, const dib_info *dib, rop_mask *
     }
 }
 
-static void draw_glyph( dib_info *dib, int x, int y, const GLYPHMETRICS *metrics,
-                        const dib_info *glyph_dib, DWORD text_color,
-                        const struct font_intensities *intensity,
-                        const struct clipped_rects *clipped_rects, RECT *bounds )
+#define GLYPH_RUN_SIZE 64
+
+struct glyph_run
 {
-    int i;
-    RECT rect, clipped_rect;
-    POINT src_origin;
+    const struct cached_glyph *glyph;
+    RECT                       rect;
+};
 
-    rect.left   = x          + metrics->gmptGlyphOrigin.x;
-    rect.top    = y          - metrics->gmptGlyphOrigin.y;
-    rect.right  = rect.left  + metrics->gmBlackBoxX;
-    rect.bottom = rect.top   + metrics->gmBlackBoxY;
-    if (bounds) add_bounds_rect( bounds, &rect );
+/***********************************************************************
+ *         draw_glyph_run
+ *
+ * Draw a run of glyphs, one clip rectangle at a time.
+ */
+static void draw_glyph_run( dib_info *dib, const struct glyph_run *run, UINT count, const RECT *run_rect,
+                            dib_info *glyph_dib, DWORD text_color,
+                            const struct font_intensities *intensity,
+                            const struct clipped_rects *clipped_rects )
+{
+    const struct cached_glyph *glyph;
+    RECT clipped_rect;
+    POINT src_origin;
+    int i, j;
 
     for (i = 0; i < clipped_rects->count; i++)
     {
-        if (intersect_rect( &clipped_rect, &rect, clipped_rects->rects + i ))
+        const RECT *clip = clipped_rects->rects + i;
+
+        if (clip->top >= run_rect->bottom) break;  /* clip rectangles are sorted by bands */
+        if (!intersect_rect( &clipped_rect, clip, run_rect )) continue;
+
+        for (j = 0; j < count; j++)
         {
-            src_origin.x = clipped_rect.left - rect.left;
-            src_origin.y = clipped_rect.top  - rect.top;
+            if (!intersect_rect( &clipped_rect, &run[j].rect, clip )) continue;
+
+            glyph = run[j].glyph;
+            glyph_dib->width       = glyph->metrics.gmBlackBoxX;
+            glyph_dib->height      = glyph->metrics.gmBlackBoxY;
+            glyph_dib->rect.right  = glyph->metrics.gmBlackBoxX;
+            glyph_dib->rect.bottom = glyph->metrics.gmBlackBoxY;
+            glyph_dib->stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib->bit_count );
+            glyph_dib->bits.ptr    = (void *)glyph->bits;
+
+            src_origin.x = clipped_rect.left - run[j].rect.left;
+            src_origin.y = clipped_rect.top  - run[j].rect.top;
 
             if (glyph_dib->bit_count == 32)
                 dib->funcs->draw_subpixel_glyph( dib, &clipped_rect, glyph_dib, &src_origin,
@@ -769,7 +852,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     bit_count = get_glyph_depth( font->aa_flags );
     stride = get_dib_stride( metrics.gmBlackBoxX, bit_count );
     size = metrics.gmBlackBoxY * stride;
-    glyph = malloc( FIELD_OFFSET( struct cached_glyph, bits[size] ));
+    glyph = alloc_cached_glyph( font, FIELD_OFFSET( struct cached_glyph, bits[size] ));
     if (!glyph) return NULL;
     if (!size) goto done;  /* empty glyph */
 
@@ -777,11 +860,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
     ret = NtGdiGetGlyphOutline( dc->hSelf, index, ggo_flags, &metrics, size, glyph->bits,
                                 &identity, FALSE );
-    if (ret == GDI_ERROR)
-    {
-        free( glyph );
-        return NULL;
-    }
+    if (ret == GDI_ERROR) return NULL;
     assert( ret <= size );
     if (font->aa_flags == GGO_BITMAP)
     {
@@ -811,8 +890,10 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
                            UINT flags, const WCHAR *str, UINT count, const INT *dx,
                            const struct clipped_rects *clipped_rects, RECT *bounds )
 {
-    UINT i;
-    struct cached_glyph *glyph;
+    UINT i, run_count = 0, hits = 0, misses = 0;
+    const struct cached_glyph *glyph;
+    struct glyph_run run[GLYPH_RUN_SIZE];
+    RECT run_rect, *rect;
     dib_info glyph_dib;
     DWORD text_color;
     struct font_intensities intensity;
@@ -830,19 +911,32 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
     else
         get_aa_ranges( dib->funcs->pixel_to_colorref( dib, text_color ), intensity.ranges );
 
+    reset_bounds( &run_rect );
+
     for (i = 0; i < count; i++)
     {
-        if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
-            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        if ((glyph = get_cached_glyph( font, str[i], flags ))) hits++;
+        else if ((glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) misses++;
+        else continue;
 
-        glyph_dib.width       = glyph->metrics.gmBlackBoxX;
-        glyph_dib.height      = glyph->metrics.gmBlackBoxY;
-        glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
-        glyph_dib.rect.bottom = glyph->metrics.gmBlackBoxY;
-        glyph_dib.stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib.bit_count );
-        glyph_dib.bits.ptr    = glyph->bits;
-
-        draw_glyph( dib, x, y, &glyph->metrics, &glyph_dib, text_color, &intensity, clipped_rects, bounds );
+        if (glyph->metrics.gmBlackBoxX && glyph->metrics.gmBlackBoxY)
+        {
+            rect = &run[run_count].rect;
+            rect->left   = x           + glyph->metrics.gmptGlyphOrigin.x;
+            rect->top    = y           - glyph->metrics.gmptGlyphOrigin.y;
+            rect->right  = rect->left  + glyph->metrics.gmBlackBoxX;
+            rect->bottom = rect->top   + glyph->metrics.gmBlackBoxY;
+            run[run_count++].glyph = glyph;
+            add_bounds_rect( &run_rect, rect );
+
+            if (run_count == GLYPH_RUN_SIZE)
+            {
+                draw_glyph_run( dib, run, run_count, &run_rect, &glyph_dib, text_color, &intensity, clipped_rects );
+                if (bounds) add_bounds_rect( bounds, &run_rect );
+                reset_bounds( &run_rect );
+                run_count = 0;
+            }
+        }
 
         if (dx)
         {
@@ -860,6 +954,15 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
             y += glyph->metrics.gmCellIncY;
         }
     }
+
+    if (run_count)
+    {
+        draw_glyph_run( dib, run, run_count, &run_rect, &glyph_dib, text_color, &intensity, clipped_rects );
+        if (bounds) add_bounds_rect( bounds, &run_rect );
+    }
+
+    if (hits) InterlockedExchangeAdd( &font->hits, hits );
+    if (misses) InterlockedExchangeAdd( &font->misses, misses );
 }
 
 BOOL render_aa_text_bitmapinfo( DC *dc, BITMAPINFO *info, struct gdi_image_bits *bits,
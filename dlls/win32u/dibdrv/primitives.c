@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -268,10 +271,24 @@ static inline void memset_16( WORD *start, WORD val, DWORD size )
 #endif
 }
 
+static inline void do_rop_line_32( DWORD *ptr, DWORD and, DWORD xor, int len )
+{
+#ifdef __SSE2__
+    const __m128i and4 = _mm_set1_epi32( and ), xor4 = _mm_set1_epi32( xor );
+
+    for ( ; len >= 4; len -= 4, ptr += 4)
+    {
+        __m128i val = _mm_loadu_si128( (const __m128i *)ptr );
+        _mm_storeu_si128( (__m128i *)ptr, _mm_xor_si128( _mm_and_si128( val, and4 ), xor4 ));
+    }
+#endif
+    for ( ; len > 0; len--) do_rop_32( ptr++, and, xor );
+}
+
 static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
 {
-    DWORD *ptr, *start;
-    int x, y, i;
+    DWORD *start;
+    int y, i;
 
     for(i = 0; i < num; i++, rc++)
     {
@@ -280,8 +297,7 @@ static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD a
         start = get_pixel_ptr_32(dib, rc->left, rc->top);
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
-                for(x = rc->left, ptr = start; x < rc->right; x++)
-                    do_rop_32(ptr++, and, xor);
+                do_rop_line_32( start, and, xor, rc->right - rc->left );
         else
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
                 memset_32( start, xor, rc->right - rc->left );
@@ -4664,6 +4680,58 @@ static inline DWORD blend_argb_alpha( DWORD dst, DWORD src, DWORD alpha )
             (alpha + ((BYTE)(dst >> 24) * (255 - alpha) + 127) / 255) << 24);
 }
 
+#ifdef __SSE2__
+/* (val + 127) / 255 for each 16-bit lane, exact for val <= 255 * 255 */
+static inline __m128i div255_epi16( __m128i val )
+{
+    val = _mm_add_epi16( val, _mm_set1_epi16( 127 ));
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( val, _mm_set1_epi16( 1 )), _mm_srli_epi16( val, 8 )), 8 );
+}
+
+/* blend_argb() on two unpacked pixels */
+static inline __m128i blend_argb_epi16( __m128i dst, __m128i src )
+{
+    __m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+
+    alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+    return _mm_add_epi16( src, div255_epi16( _mm_mullo_epi16( dst, alpha )));
+}
+#endif
+
+/* blend_argb_alpha() on a whole line, alpha == 255 is equivalent to blend_argb() */
+static inline void blend_argb_line( DWORD *dst, const DWORD *src, DWORD alpha, int len )
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi16( 0xff );
+    const __m128i alpha8 = _mm_set1_epi16( alpha );
+
+    for ( ; len >= 4; len -= 4, dst += 4, src += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)src );
+        __m128i d = _mm_loadu_si128( (const __m128i *)dst );
+        __m128i src_lo = _mm_unpacklo_epi8( s, zero ), src_hi = _mm_unpackhi_epi8( s, zero );
+        __m128i lo, hi, val, carry;
+
+        if (alpha != 255)
+        {
+            src_lo = div255_epi16( _mm_mullo_epi16( src_lo, alpha8 ));
+            src_hi = div255_epi16( _mm_mullo_epi16( src_hi, alpha8 ));
+        }
+        lo = blend_argb_epi16( _mm_unpacklo_epi8( d, zero ), src_lo );
+        hi = blend_argb_epi16( _mm_unpackhi_epi8( d, zero ), src_hi );
+
+        /* channels may overflow into the next one, like in the scalar version */
+        val = _mm_packus_epi16( _mm_and_si128( lo, mask ), _mm_and_si128( hi, mask ));
+        carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ));
+        _mm_storeu_si128( (__m128i *)dst, _mm_or_si128( val, _mm_slli_epi32( carry, 8 )));
+    }
+#endif
+    if (alpha == 255)
+        for ( ; len > 0; len--, dst++, src++) *dst = blend_argb( *dst, *src );
+    else
+        for ( ; len > 0; len--, dst++, src++) *dst = blend_argb_alpha( *dst, *src, alpha );
+}
+
 static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BLENDFUNCTION blend )
 {
     if (blend.AlphaFormat & AC_SRC_ALPHA)
@@ -4693,16 +4761,8 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
         DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
 
         if (blend.AlphaFormat & AC_SRC_ALPHA)
-        {
-            if (blend.SourceConstantAlpha == 255)
-                for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
-            else
-                for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-        }
+            for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+                blend_argb_line( dst_ptr, src_ptr, blend.SourceConstantAlpha, rc->right - rc->left );
         else if (src->compression == BI_RGB)
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
                 for (x = 0; x < rc->right - rc->left; x++)
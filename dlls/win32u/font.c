@@ -2183,6 +2183,27 @@ static struct gdi_font *alloc_gdi_font( const WCHAR *file, void *data_ptr, SIZE_
     return font;
 }
 
+/* ABC widths cache
+ *
+ * The unrotated ABC widths of chars and glyph indices are cached separately from the
+ * glyph metrics so that the text extent functions can read them without font_lock.
+ * Entries are only ever added, under font_lock, and are published by setting their
+ * valid flag last; the pages are never freed before the font itself. */
+
+#define ABC_CACHE_PAGE_SIZE  256
+#define ABC_CACHE_PAGES      (0x10000 / ABC_CACHE_PAGE_SIZE)
+
+struct abc_cache_entry
+{
+    ABC  abc;
+    LONG valid;
+};
+
+struct abc_cache
+{
+    struct abc_cache_entry *pages[2 * ABC_CACHE_PAGES];  /* chars, then glyph indices */
+};
+
 static void free_gdi_font( struct gdi_font *font )
 {
     DWORD i;
@@ -2196,6 +2217,11 @@ static void free_gdi_font( struct gdi_font *font )
         free_gdi_font( child );
     }
     for (i = 0; i < font->gm_size; i++) free( font->gm[i] );
+    if (font->abc_cache)
+    {
+        for (i = 0; i < ARRAY_SIZE(font->abc_cache->pages); i++) free( font->abc_cache->pages[i] );
+        free( font->abc_cache );
+    }
     free( font->otm.otmpFamilyName );
     free( font->otm.otmpStyleName );
     free( font->otm.otmpFaceName );
@@ -2287,6 +2313,44 @@ static void set_gdi_font_glyph_metrics( struct gdi_font *font, UINT index,
 }
 
 
+static BOOL get_cached_abc( struct gdi_font *font, UINT index, UINT format, ABC *abc )
+{
+    struct abc_cache *cache = __atomic_load_n( &font->abc_cache, __ATOMIC_ACQUIRE );
+    struct abc_cache_entry *page, *entry;
+
+    if (!cache || index >= 0x10000) return FALSE;
+    if (format & GGO_GLYPH_INDEX) index += 0x10000;
+    if (!(page = __atomic_load_n( &cache->pages[index / ABC_CACHE_PAGE_SIZE], __ATOMIC_ACQUIRE )))
+        return FALSE;
+    entry = &page[index % ABC_CACHE_PAGE_SIZE];
+    if (!__atomic_load_n( &entry->valid, __ATOMIC_ACQUIRE )) return FALSE;
+    *abc = entry->abc;
+    return TRUE;
+}
+
+/* must be called with font_lock held */
+static void set_cached_abc( struct gdi_font *font, UINT index, UINT format, const ABC *abc )
+{
+    struct abc_cache *cache = font->abc_cache;
+    struct abc_cache_entry *page;
+
+    if (index >= 0x10000) return;
+    if (format & GGO_GLYPH_INDEX) index += 0x10000;
+    if (!cache)
+    {
+        if (!(cache = calloc( 1, sizeof(*cache) ))) return;
+        __atomic_store_n( &font->abc_cache, cache, __ATOMIC_RELEASE );
+    }
+    if (!(page = cache->pages[index / ABC_CACHE_PAGE_SIZE]))
+    {
+        if (!(page = calloc( ABC_CACHE_PAGE_SIZE, sizeof(*page) ))) return;
+        __atomic_store_n( &cache->pages[index / ABC_CACHE_PAGE_SIZE], page, __ATOMIC_RELEASE );
+    }
+    page[index % ABC_CACHE_PAGE_SIZE].abc = *abc;
+    __atomic_store_n( &page[index % ABC_CACHE_PAGE_SIZE].valid, TRUE, __ATOMIC_RELEASE );
+}
+
+
 /* GSUB table support */
 
 typedef struct
@@ -3618,6 +3682,24 @@ done:
 }
 
 
+/* get the ABC widths of a char or glyph index, only taking font_lock if they aren't cached;
+ * the caller must release font_lock if *locked has been set */
+static BOOL get_glyph_abc( struct gdi_font *font, UINT glyph, UINT format, ABC *abc, BOOL *locked )
+{
+    if (get_cached_abc( font, glyph, format, abc )) return TRUE;
+
+    if (!*locked)
+    {
+        pthread_mutex_lock( &font_lock );
+        *locked = TRUE;
+    }
+    if (get_glyph_outline( font, glyph, GGO_METRICS | format, NULL, abc, 0, NULL, NULL ) == GDI_ERROR)
+        return FALSE;
+    set_cached_abc( font, glyph, format, abc );
+    return TRUE;
+}
+
+
 /*************************************************************
  * font_FontIsLinked
  */
@@ -3641,6 +3723,7 @@ static BOOL CDECL font_GetCharABCWidths( PHYSDEV dev, UINT first, UINT count,
                                          WCHAR *chars, ABC *buffer )
 {
     struct font_physdev *physdev = get_font_dev( dev );
+    BOOL locked = FALSE;
     UINT c, i;
 
     if (!physdev->font)
@@ -3651,13 +3734,12 @@ static BOOL CDECL font_GetCharABCWidths( PHYSDEV dev, UINT first, UINT count,
 
     TRACE( "%p, %u, %u, %p\n", physdev->font, first, count, buffer );
 
-    pthread_mutex_lock( &font_lock );
     for (i = 0; i < count; i++)
     {
         c = chars ? chars[i] : first + i;
-        get_glyph_outline( physdev->font, c, GGO_METRICS, NULL, &buffer[i], 0, NULL, NULL );
+        get_glyph_abc( physdev->font, c, 0, &buffer[i], &locked );
     }
-    pthread_mutex_unlock( &font_lock );
+    if (locked) pthread_mutex_unlock( &font_lock );
     return TRUE;
 }
 
@@ -3668,6 +3750,7 @@ static BOOL CDECL font_GetCharABCWidths( PHYSDEV dev, UINT first, UINT count,
 static BOOL CDECL font_GetCharABCWidthsI( PHYSDEV dev, UINT first, UINT count, WORD *gi, ABC *buffer )
 {
     struct font_physdev *physdev = get_font_dev( dev );
+    BOOL locked = FALSE;
     UINT c;
 
     if (!physdev->font)
@@ -3678,11 +3761,9 @@ static BOOL CDECL font_GetCharABCWidthsI( PHYSDEV dev, UINT first, UINT count, W
 
     TRACE( "%p, %u, %u, %p\n", physdev->font, first, count, buffer );
 
-    pthread_mutex_lock( &font_lock );
     for (c = 0; c < count; c++, buffer++)
-        get_glyph_outline( physdev->font, gi ? gi[c] : first + c, GGO_METRICS | GGO_GLYPH_INDEX,
-                           NULL, buffer, 0, NULL, NULL );
-    pthread_mutex_unlock( &font_lock );
+        get_glyph_abc( physdev->font, gi ? gi[c] : first + c, GGO_GLYPH_INDEX, buffer, &locked );
+    if (locked) pthread_mutex_unlock( &font_lock );
     return TRUE;
 }
 
@@ -3695,6 +3776,7 @@ static BOOL CDECL font_GetCharWidth( PHYSDEV dev, UINT first, UINT count,
 {
     struct font_physdev *physdev = get_font_dev( dev );
     UINT c, i;
+    BOOL locked = FALSE;
     ABC abc;
 
     if (!physdev->font)
@@ -3705,16 +3787,15 @@ static BOOL CDECL font_GetCharWidth( PHYSDEV dev, UINT first, UINT count,
 
     TRACE( "%p, %d, %d, %p\n", physdev->font, first, count, buffer );
 
-    pthread_mutex_lock( &font_lock );
     for (i = 0; i < count; i++)
     {
         c = chars ? chars[i] : i + first;
-        if (get_glyph_outline( physdev->font, c, GGO_METRICS, NULL, &abc, 0, NULL, NULL ) == GDI_ERROR)
+        if (!get_glyph_abc( physdev->font, c, 0, &abc, &locked ))
             buffer[i] = 0;
         else
             buffer[i] = abc.abcA + abc.abcB + abc.abcC;
     }
-    pthread_mutex_unlock( &font_lock );
+    if (locked) pthread_mutex_unlock( &font_lock );
     return TRUE;
 }
 
@@ -4055,6 +4136,7 @@ static BOOL CDECL font_GetTextExtentExPoint( PHYSDEV dev, const WCHAR *str, INT
 {
     struct font_physdev *physdev = get_font_dev( dev );
     INT i, pos;
+    BOOL locked = FALSE;
     ABC abc;
 
     if (!physdev->font)
@@ -4065,14 +4147,13 @@ static BOOL CDECL font_GetTextExtentExPoint( PHYSDEV dev, const WCHAR *str, INT
 
     TRACE( "%p, %s, %d\n", physdev->font, debugstr_wn(str, count), count );
 
-    pthread_mutex_lock( &font_lock );
     for (i = pos = 0; i < count; i++)
     {
-        get_glyph_outline( physdev->font, str[i], GGO_METRICS, NULL, &abc, 0, NULL, NULL );
+        get_glyph_abc( physdev->font, str[i], 0, &abc, &locked );
         pos += abc.abcA + abc.abcB + abc.abcC;
         dxs[i] = pos;
     }
-    pthread_mutex_unlock( &font_lock );
+    if (locked) pthread_mutex_unlock( &font_lock );
     return TRUE;
 }
 
@@ -4084,6 +4165,7 @@ static BOOL CDECL font_GetTextExtentExPointI( PHYSDEV dev, const WORD *indices,
 {
     struct font_physdev *physdev = get_font_dev( dev );
     INT i, pos;
+    BOOL locked = FALSE;
     ABC abc;
 
     if (!physdev->font)
@@ -4094,15 +4176,13 @@ static BOOL CDECL font_GetTextExtentExPointI( PHYSDEV dev, const WORD *indices,
 
     TRACE( "%p, %p, %d\n", physdev->font, indices, count );
 
-    pthread_mutex_lock( &font_lock );
     for (i = pos = 0; i < count; i++)
     {
-        get_glyph_outline( physdev->font, indices[i], GGO_METRICS | GGO_GLYPH_INDEX,
-                           NULL, &abc, 0, NULL, NULL );
+        get_glyph_abc( physdev->font, indices[i], GGO_GLYPH_INDEX, &abc, &locked );
         pos += abc.abcA + abc.abcB + abc.abcC;
         dxs[i] = pos;
     }
-    pthread_mutex_unlock( &font_lock );
+    if (locked) pthread_mutex_unlock( &font_lock );
     return TRUE;
 }
 
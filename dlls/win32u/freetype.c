@@ -123,6 +123,7 @@
 #include "ntgdi_private.h"
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 
 #ifdef HAVE_FREETYPE
 
@@ -1186,6 +1187,367 @@ struct unix_face
     struct bitmap_font_size size;
 };
 
+/* font index
+ *
+ * The faces found while loading the fonts at startup are saved to an index file in
+ * the prefix, so that the next processes can skip parsing the font files that didn't
+ * change. Files that can't be parsed are recorded too, with num_faces set to 0. */
+
+#define FONT_INDEX_MAGIC    0x78646e69  /* "indx" */
+#define FONT_INDEX_VERSION  1
+
+struct font_index_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD lcid;       /* system locale the names have been decoded with */
+    DWORD count;      /* number of entries */
+};
+
+enum font_index_name
+{
+    FONT_INDEX_FAMILY_NAME,
+    FONT_INDEX_SECOND_NAME,
+    FONT_INDEX_STYLE_NAME,
+    FONT_INDEX_FULL_NAME,
+    FONT_INDEX_NAME_COUNT
+};
+
+struct font_index_entry
+{
+    DWORD                   size;           /* total size of the entry, including the names */
+    DWORD                   face_index;
+    DWORD                   flags;          /* ADDFONT_ALLOW_BITMAP */
+    DWORD                   num_faces;      /* 0 if the face couldn't be loaded */
+    ULONGLONG               file_size;
+    LONGLONG                file_mtime;
+    DWORD                   scalable;
+    DWORD                   ntm_flags;
+    DWORD                   font_version;
+    FONTSIGNATURE           fs;
+    struct bitmap_font_size bitmap_size;
+    WORD                    name_len[FONT_INDEX_NAME_COUNT];  /* in WCHARs including the null, 0 if no name */
+    WORD                    unix_name_len;  /* including the null */
+    /* followed by the names, then by the unix file name */
+};
+
+struct font_index_key
+{
+    const char *unix_name;
+    DWORD       face_index;
+    DWORD       flags;
+};
+
+struct font_index_node
+{
+    struct wine_rb_entry           entry;
+    const struct font_index_entry *data;       /* points to the mapped file or to an allocated entry */
+    BOOL                           allocated;
+    BOOL                           used;       /* seen while loading the fonts */
+};
+
+static const WCHAR *font_index_get_name( const struct font_index_entry *entry, enum font_index_name name )
+{
+    const WCHAR *ptr = (const WCHAR *)(entry + 1);
+    int i;
+
+    if (!entry->name_len[name]) return NULL;
+    for (i = 0; i < name; i++) ptr += entry->name_len[i];
+    return ptr;
+}
+
+static const char *font_index_get_unix_name( const struct font_index_entry *entry )
+{
+    const WCHAR *ptr = (const WCHAR *)(entry + 1);
+    int i;
+
+    for (i = 0; i < FONT_INDEX_NAME_COUNT; i++) ptr += entry->name_len[i];
+    return (const char *)ptr;
+}
+
+static int font_index_compare( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct font_index_key *k = key;
+    const struct font_index_entry *data = WINE_RB_ENTRY_VALUE( entry, struct font_index_node, entry )->data;
+
+    if (k->face_index != data->face_index) return k->face_index > data->face_index ? 1 : -1;
+    if (k->flags != data->flags) return k->flags > data->flags ? 1 : -1;
+    return strcmp( k->unix_name, font_index_get_unix_name( data ) );
+}
+
+static struct wine_rb_tree font_index_tree = { font_index_compare };
+static BOOL font_index_enabled;  /* only used while loading the fonts at startup */
+static BOOL font_index_dirty;
+static void *font_index_map;
+static size_t font_index_map_size;
+
+static char *get_font_index_path(void)
+{
+    const char *dir = ntdll_get_config_dir();
+    char *path;
+
+    if (!dir || !(path = malloc( strlen( dir ) + sizeof("/font_index") ))) return NULL;
+    strcpy( path, dir );
+    strcat( path, "/font_index" );
+    return path;
+}
+
+static BOOL add_font_index_node( const struct font_index_entry *data, BOOL allocated )
+{
+    struct font_index_node *node;
+    struct font_index_key key;
+
+    key.unix_name = font_index_get_unix_name( data );
+    key.face_index = data->face_index;
+    key.flags = data->flags;
+    if (wine_rb_get( &font_index_tree, &key )) return FALSE;
+    if (!(node = malloc( sizeof(*node) ))) return FALSE;
+    node->data = data;
+    node->allocated = allocated;
+    node->used = FALSE;
+    wine_rb_put( &font_index_tree, &key, &node->entry );
+    return TRUE;
+}
+
+static void free_font_index_node( struct wine_rb_entry *entry, void *context )
+{
+    struct font_index_node *node = WINE_RB_ENTRY_VALUE( entry, struct font_index_node, entry );
+
+    if (node->allocated) free( (void *)node->data );
+    free( node );
+}
+
+static void load_font_index(void)
+{
+    const struct font_index_header *header;
+    const struct font_index_entry *entry;
+    const char *ptr, *end;
+    struct stat st;
+    char *path;
+    DWORD i, len;
+    int fd, j;
+
+    font_index_enabled = TRUE;
+    font_index_dirty = TRUE;
+
+    if (!(path = get_font_index_path())) return;
+    fd = open( path, O_RDONLY );
+    free( path );
+    if (fd == -1) return;
+
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) ||
+        (font_index_map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        font_index_map = NULL;
+        close( fd );
+        return;
+    }
+    close( fd );
+    font_index_map_size = st.st_size;
+
+    header = font_index_map;
+    if (header->magic != FONT_INDEX_MAGIC || header->version != FONT_INDEX_VERSION ||
+        header->lcid != system_lcid)
+        goto invalid;
+
+    ptr = (const char *)(header + 1);
+    end = (const char *)font_index_map + font_index_map_size;
+    for (i = 0; i < header->count; i++)
+    {
+        entry = (const struct font_index_entry *)ptr;
+        if (end - ptr < sizeof(*entry) || entry->size < sizeof(*entry) || entry->size > end - ptr ||
+            entry->size % sizeof(ULONGLONG))
+            goto invalid;
+        for (j = 0, len = 0; j < FONT_INDEX_NAME_COUNT; j++) len += entry->name_len[j];
+        len = sizeof(*entry) + len * sizeof(WCHAR) + entry->unix_name_len;
+        if (!entry->unix_name_len || len > entry->size || font_index_get_unix_name( entry )[entry->unix_name_len - 1])
+            goto invalid;
+        add_font_index_node( entry, FALSE );
+        ptr += entry->size;
+    }
+
+    TRACE( "loaded %u entries\n", header->count );
+    font_index_dirty = FALSE;
+    return;
+
+invalid:
+    WARN( "ignoring invalid font index\n" );
+    wine_rb_destroy( &font_index_tree, free_font_index_node, NULL );
+    munmap( font_index_map, font_index_map_size );
+    font_index_map = NULL;
+}
+
+static const struct font_index_entry *find_font_index_entry( const char *unix_name, DWORD face_index,
+                                                             DWORD flags, const struct stat *st )
+{
+    struct font_index_node *node;
+    struct wine_rb_entry *entry;
+    struct font_index_key key;
+
+    if (!font_index_enabled) return NULL;
+
+    key.unix_name = unix_name;
+    key.face_index = face_index;
+    key.flags = flags & ADDFONT_ALLOW_BITMAP;
+    if (!(entry = wine_rb_get( &font_index_tree, &key ))) return NULL;
+
+    node = WINE_RB_ENTRY_VALUE( entry, struct font_index_node, entry );
+    if (node->data->file_size != st->st_size || node->data->file_mtime != st->st_mtime)
+    {
+        TRACE( "%s changed\n", debugstr_a(unix_name) );
+        wine_rb_remove( &font_index_tree, entry );
+        free_font_index_node( entry, NULL );
+        font_index_dirty = TRUE;
+        return NULL;
+    }
+    node->used = TRUE;
+    return node->data;
+}
+
+static void add_font_index_entry( const char *unix_name, DWORD face_index, DWORD flags,
+                                  const struct stat *st, const struct unix_face *face )
+{
+    const WCHAR *names[FONT_INDEX_NAME_COUNT];
+    struct font_index_entry *entry;
+    struct wine_rb_entry *node;
+    struct font_index_key key;
+    size_t size, unix_name_len = strlen( unix_name ) + 1;
+    WCHAR *ptr;
+    int i;
+
+    if (!font_index_enabled || unix_name_len > 0xffff) return;
+
+    key.unix_name = unix_name;
+    key.face_index = face_index;
+    key.flags = flags & ADDFONT_ALLOW_BITMAP;
+    if ((node = wine_rb_get( &font_index_tree, &key )))
+    {
+        wine_rb_remove( &font_index_tree, node );
+        free_font_index_node( node, NULL );
+    }
+
+    memset( names, 0, sizeof(names) );
+    if (face)
+    {
+        names[FONT_INDEX_FAMILY_NAME] = face->family_name;
+        names[FONT_INDEX_SECOND_NAME] = face->second_name;
+        names[FONT_INDEX_STYLE_NAME]  = face->style_name;
+        names[FONT_INDEX_FULL_NAME]   = face->full_name;
+    }
+
+    size = sizeof(*entry) + unix_name_len;
+    for (i = 0; i < FONT_INDEX_NAME_COUNT; i++)
+        if (names[i]) size += (lstrlenW( names[i] ) + 1) * sizeof(WCHAR);
+    size = (size + sizeof(ULONGLONG) - 1) & ~(sizeof(ULONGLONG) - 1);
+
+    if (!(entry = calloc( 1, size ))) return;
+    entry->size       = size;
+    entry->face_index = face_index;
+    entry->flags      = key.flags;
+    entry->file_size  = st->st_size;
+    entry->file_mtime = st->st_mtime;
+    if (face)
+    {
+        entry->num_faces    = face->num_faces;
+        entry->scalable     = face->scalable;
+        entry->ntm_flags    = face->ntm_flags;
+        entry->font_version = face->font_version;
+        entry->fs           = face->fs;
+        entry->bitmap_size  = face->size;
+    }
+    ptr = (WCHAR *)(entry + 1);
+    for (i = 0; i < FONT_INDEX_NAME_COUNT; i++)
+    {
+        if (!names[i]) continue;
+        entry->name_len[i] = lstrlenW( names[i] ) + 1;
+        memcpy( ptr, names[i], entry->name_len[i] * sizeof(WCHAR) );
+        ptr += entry->name_len[i];
+    }
+    entry->unix_name_len = unix_name_len;
+    memcpy( ptr, unix_name, unix_name_len );
+
+    if (!add_font_index_node( entry, TRUE )) free( entry );
+    else
+    {
+        WINE_RB_ENTRY_VALUE( wine_rb_get( &font_index_tree, &key ), struct font_index_node, entry )->used = TRUE;
+        font_index_dirty = TRUE;
+    }
+}
+
+static struct unix_face *unix_face_from_index( const struct font_index_entry *entry )
+{
+    struct unix_face *This;
+
+    if (!entry->num_faces || !entry->name_len[FONT_INDEX_FAMILY_NAME]) return NULL;
+    if (!(This = calloc( 1, sizeof(*This) ))) return NULL;
+
+    This->scalable     = entry->scalable;
+    This->num_faces    = entry->num_faces;
+    This->family_name  = strdupW( font_index_get_name( entry, FONT_INDEX_FAMILY_NAME ));
+    if (entry->name_len[FONT_INDEX_SECOND_NAME])
+        This->second_name = strdupW( font_index_get_name( entry, FONT_INDEX_SECOND_NAME ));
+    if (entry->name_len[FONT_INDEX_STYLE_NAME])
+        This->style_name = strdupW( font_index_get_name( entry, FONT_INDEX_STYLE_NAME ));
+    if (entry->name_len[FONT_INDEX_FULL_NAME])
+        This->full_name = strdupW( font_index_get_name( entry, FONT_INDEX_FULL_NAME ));
+    This->ntm_flags    = entry->ntm_flags;
+    This->font_version = entry->font_version;
+    This->fs           = entry->fs;
+    This->size         = entry->bitmap_size;
+    return This;
+}
+
+static void save_font_index(void)
+{
+    struct font_index_header header;
+    struct font_index_node *node;
+    char *path, *tmp_path = NULL;
+    int fd = -1;
+    BOOL ret = FALSE;
+
+    if (!font_index_enabled) return;
+    font_index_enabled = FALSE;
+
+    header.magic   = FONT_INDEX_MAGIC;
+    header.version = FONT_INDEX_VERSION;
+    header.lcid    = system_lcid;
+    header.count   = 0;
+    WINE_RB_FOR_EACH_ENTRY( node, &font_index_tree, struct font_index_node, entry )
+    {
+        if (node->used) header.count++;
+        else font_index_dirty = TRUE;  /* drop entries for files that are gone */
+    }
+
+    if (!font_index_dirty || !(path = get_font_index_path())) goto done;
+
+    if ((tmp_path = malloc( strlen( path ) + 16 )))
+    {
+        sprintf( tmp_path, "%s.%u", path, getpid() );
+        fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+    }
+    if (fd != -1)
+    {
+        ret = write( fd, &header, sizeof(header) ) == sizeof(header);
+        WINE_RB_FOR_EACH_ENTRY( node, &font_index_tree, struct font_index_node, entry )
+        {
+            if (!ret) break;
+            if (!node->used) continue;
+            ret = write( fd, node->data, node->data->size ) == node->data->size;
+        }
+        close( fd );
+        if (ret) ret = !rename( tmp_path, path );
+        if (!ret) unlink( tmp_path );
+        else TRACE( "saved %u entries to %s\n", header.count, debugstr_a(path) );
+    }
+    free( tmp_path );
+    free( path );
+
+done:
+    wine_rb_destroy( &font_index_tree, free_font_index_node, NULL );
+    if (font_index_map) munmap( font_index_map, font_index_map_size );
+    font_index_map = NULL;
+}
+
 static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr, DWORD data_size,
                                            UINT face_index, DWORD flags )
 {
@@ -1193,6 +1555,7 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
 
     const struct ttc_sfnt_v1 *ttc_sfnt_v1;
     const struct tt_name_v0 *tt_name_v0;
+    const struct font_index_entry *entry;
     struct unix_face *This;
     struct stat st;
     DWORD face_count;
@@ -1209,6 +1572,11 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
             close( fd );
             return NULL;
         }
+        if ((entry = find_font_index_entry( unix_name, face_index, flags, &st )))
+        {
+            close( fd );
+            return unix_face_from_index( entry );
+        }
         data_size = st.st_size;
         data_ptr = mmap( NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0 );
         close( fd );
@@ -1298,7 +1666,11 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
     }
 
 done:
-    if (unix_name) munmap( data_ptr, data_size );
+    if (unix_name)
+    {
+        add_font_index_entry( unix_name, face_index, flags, &st, This );
+        munmap( data_ptr, data_size );
+    }
     return This;
 }
 
@@ -1936,6 +2308,7 @@ static void freetype_load_fonts(void)
 #elif defined(__ANDROID__)
     ReadFontDir("/system/fonts", TRUE);
 #endif
+    save_font_index();
 }
 
 /* Some fonts have large usWinDescent values, as a result of storing signed short
@@ -4292,6 +4665,7 @@ const struct font_backend_funcs *init_freetype_lib(void)
     init_fontconfig();
 #endif
     NtQueryDefaultLocale( FALSE, &system_lcid );
+    load_font_index();
     return &font_funcs;
 }
 
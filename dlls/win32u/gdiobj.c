@@ -1118,6 +1118,7 @@ static struct unix_funcs unix_funcs =
     NtGdiPatBlt,
     NtGdiPlgBlt,
     NtGdiPolyDraw,
+    NtGdiPolyPatBlt,
     NtGdiPolyPolyDraw,
     NtGdiPtVisible,
     NtGdiRectVisible,
@@ -242,6 +242,7 @@ struct gdi_font
     DWORD                  refcount;
     DWORD                  gm_size;
     struct glyph_metrics **gm;
+    struct abc_cache      *abc_cache;  /* can be read without locking, see get_cached_abc() */
     OUTLINETEXTMETRICW     otm;
     KERNINGPAIR           *kern_pairs;
     int                    kern_count;
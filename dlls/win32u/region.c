@@ -1854,6 +1854,17 @@ static BOOL REGION_IntersectO(WINEREGION *pReg,  RECT *r1, RECT *r1End,
     return TRUE;
 }
 
+/***********************************************************************
+ *	     rect_contains_region
+ *
+ * Check if a rectangle contains all of a region.
+ */
+static inline BOOL rect_contains_region( const RECT *rect, const WINEREGION *reg )
+{
+    return (rect->left <= reg->extents.left && rect->top <= reg->extents.top &&
+            rect->right >= reg->extents.right && rect->bottom >= reg->extents.bottom);
+}
+
 /***********************************************************************
  *	     REGION_IntersectRegion
  */
@@ -1864,6 +1875,10 @@ static BOOL REGION_IntersectRegion(WINEREGION *newReg, WINEREGION *reg1,
     if ( (!(reg1->numRects)) || (!(reg2->numRects))  ||
 	(!overlapping(&reg1->extents, &reg2->extents)))
 	newReg->numRects = 0;
+    else if (reg2->numRects == 1 && rect_contains_region( &reg2->extents, reg1 ))
+        return REGION_CopyRegion( newReg, reg1 );
+    else if (reg1->numRects == 1 && rect_contains_region( &reg1->extents, reg2 ))
+        return REGION_CopyRegion( newReg, reg2 );
     else
 	if (!REGION_RegionOp (newReg, reg1, reg2, REGION_IntersectO, NULL, NULL)) return FALSE;
 
@@ -2168,6 +2183,25 @@ static BOOL REGION_SubtractO (WINEREGION *pReg, RECT *r1, RECT *r1End,
     return TRUE;
 }
 
+/***********************************************************************
+ *	     REGION_SubtractRect
+ *
+ *      Subtract rectangle s from rectangle m, which must overlap, and
+ *      leave the result in regD. The result has at most 4 rectangles.
+ */
+static BOOL REGION_SubtractRect( WINEREGION *regD, RECT m, RECT s )
+{
+    INT top = max( m.top, s.top ), bottom = min( m.bottom, s.bottom );
+
+    regD->numRects = 0;
+    if (s.top > m.top && !add_rect( regD, m.left, m.top, m.right, s.top )) return FALSE;
+    if (s.left > m.left && !add_rect( regD, m.left, top, s.left, bottom )) return FALSE;
+    if (s.right < m.right && !add_rect( regD, s.right, top, m.right, bottom )) return FALSE;
+    if (s.bottom < m.bottom && !add_rect( regD, m.left, s.bottom, m.right, m.bottom )) return FALSE;
+    REGION_SetExtents( regD );
+    return TRUE;
+}
+
 /***********************************************************************
  *	     REGION_SubtractRegion
  *
@@ -2188,6 +2222,16 @@ static BOOL REGION_SubtractRegion(WINEREGION *regD, WINEREGION *regM, WINEREGION
 	(!overlapping(&regM->extents, &regS->extents)) )
 	return REGION_CopyRegion(regD, regM);
 
+    if (regS->numRects == 1)
+    {
+        if (rect_contains_region( &regS->extents, regM ))
+        {
+            empty_region( regD );
+            return TRUE;
+        }
+        if (regM->numRects == 1) return REGION_SubtractRect( regD, regM->extents, regS->extents );
+    }
+
     if (!REGION_RegionOp (regD, regM, regS, REGION_SubtractO, REGION_SubtractNonO1, NULL))
         return FALSE;
 
@@ -557,7 +557,7 @@
 @ stdcall -syscall NtGdiPathToRegion(long)
 @ stdcall NtGdiPlgBlt(long ptr long long long long long long long long long)
 @ stdcall NtGdiPolyDraw(long ptr ptr long)
-@ stub NtGdiPolyPatBlt
+@ stdcall NtGdiPolyPatBlt(long long ptr long long)
 @ stdcall NtGdiPolyPolyDraw(long ptr ptr long long)
 @ stub NtGdiPolyTextOutW
 @ stdcall -syscall NtGdiPtInRegion(long long long)
@@ -450,6 +450,12 @@ BOOL WINAPI NtGdiPolyDraw( HDC hdc, const POINT *points, const BYTE *types, DWOR
     return unix_funcs->pNtGdiPolyDraw( hdc, points, types, count );
 }
 
+BOOL WINAPI NtGdiPolyPatBlt( HDC hdc, DWORD rop, const POLYPATBLT *rects, DWORD count, DWORD mode )
+{
+    if (!unix_funcs) return FALSE;
+    return unix_funcs->pNtGdiPolyPatBlt( hdc, rop, rects, count, mode );
+}
+
 ULONG WINAPI NtGdiPolyPolyDraw( HDC hdc, const POINT *points, const UINT *counts,
                                 DWORD count, UINT function )
 {
@@ -1175,6 +1175,24 @@ void adapter_vk_copy_bo_address(struct wined3d_context *context,
     if (dst_bo && (!(dst_bo->memory_type & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) || (!(map_flags & WINED3D_MAP_DISCARD)
             && dst_bo->command_buffer_id > context_vk->completed_command_buffer_id)))
     {
+        if (!src_bo && wined3d_context_vk_get_staging_memory(context_vk, size, 16, &staging))
+        {
+            if (!(dst_ptr = adapter_vk_map_bo_address(context, &staging, size,
+                    WINED3D_MAP_NOOVERWRITE | WINED3D_MAP_WRITE)))
+            {
+                ERR("Failed to map staging memory.\n");
+                return;
+            }
+            memcpy(dst_ptr, src->addr, size);
+            range.offset = (uintptr_t)staging.addr;
+            range.size = size;
+            adapter_vk_unmap_bo_address(context, &staging, 1, &range);
+
+            adapter_vk_copy_bo_address(context, dst, &staging, size);
+
+            return;
+        }
+
         if (!(wined3d_context_vk_create_bo(context_vk, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &staging_bo)))
         {
@@ -2291,6 +2291,11 @@ HRESULT wined3d_context_gl_init(struct wined3d_context_gl *context_gl, struct wi
     }
     if (gl_info->supported[ARB_CLIP_CONTROL])
         GL_EXTCALL(glPointParameteri(GL_POINT_SPRITE_COORD_ORIGIN, GL_LOWER_LEFT));
+    if (gl_info->supported[ARB_PARALLEL_SHADER_COMPILE])
+    {
+        GL_EXTCALL(glMaxShaderCompilerThreadsARB(wined3d_settings.shader_compiler_threads));
+        checkGLcall("set max shader compiler threads");
+    }
 
     /* If this happens to be the first context for the device, dummy textures
      * are not created yet. In that case, they will be created (and bound) by
@@ -27,6 +27,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 VkCompareOp vk_compare_op_from_wined3d(enum wined3d_cmp_func op)
 {
@@ -1506,6 +1507,12 @@ void wined3d_context_vk_cleanup(struct wined3d_context_vk *context_vk)
     VK_CALL(vkDestroyCommandPool(device_vk->vk_device, context_vk->vk_command_pool, NULL));
     if (context_vk->vk_so_counter_bo.vk_buffer)
         wined3d_context_vk_destroy_bo(context_vk, &context_vk->vk_so_counter_bo);
+    TRACE_(d3d_perf)("Staging ring: %u uploads, %s bytes, %u stalls, %u fallbacks.\n",
+            context_vk->staging_ring.upload_count, wine_dbgstr_longlong(context_vk->staging_ring.upload_bytes),
+            context_vk->staging_ring.stall_count, context_vk->staging_ring.fallback_count);
+    if (context_vk->staging_ring.bo.vk_buffer)
+        wined3d_context_vk_destroy_bo(context_vk, &context_vk->staging_ring.bo);
+    heap_free(context_vk->staging_ring.segments);
     wined3d_context_vk_cleanup_resources(context_vk);
     wined3d_context_vk_destroy_query_pools(context_vk, &context_vk->free_occlusion_query_pools);
     wined3d_context_vk_destroy_query_pools(context_vk, &context_vk->free_timestamp_query_pools);
@@ -1759,6 +1766,136 @@ void wined3d_context_vk_wait_command_buffer(struct wined3d_context_vk *context_v
     ERR("Failed to find fence for command buffer with id 0x%s.\n", wine_dbgstr_longlong(id));
 }
 
+#define WINED3D_STAGING_RING_SIZE_VK (16 * 1024 * 1024)
+
+static void wined3d_context_vk_staging_ring_reclaim(struct wined3d_context_vk *context_vk)
+{
+    struct wined3d_staging_ring_vk *ring = &context_vk->staging_ring;
+    SIZE_T i;
+
+    for (i = 0; i < ring->segment_count; ++i)
+    {
+        if (ring->segments[i].command_buffer_id > context_vk->completed_command_buffer_id)
+            break;
+        ring->tail = ring->segments[i].end;
+    }
+    if (!i)
+        return;
+
+    ring->segment_count -= i;
+    memmove(ring->segments, &ring->segments[i], ring->segment_count * sizeof(*ring->segments));
+    if (!ring->segment_count)
+        ring->head = ring->tail = 0;
+}
+
+static BOOL wined3d_staging_ring_vk_find_space(const struct wined3d_staging_ring_vk *ring,
+        VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *offset)
+{
+    VkDeviceSize start = (ring->head + alignment - 1) / alignment * alignment;
+
+    /* The range in use is [tail, head) if tail < head, and wraps around the
+     * end of the ring otherwise. */
+    if (!ring->segment_count || ring->tail < ring->head)
+    {
+        if (start + size <= WINED3D_STAGING_RING_SIZE_VK)
+        {
+            *offset = start;
+            return TRUE;
+        }
+        if (ring->segment_count && size <= ring->tail)
+        {
+            *offset = 0;
+            return TRUE;
+        }
+        return FALSE;
+    }
+
+    if (start + size <= ring->tail)
+    {
+        *offset = start;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* Suballocates upload memory for the current command buffer from a
+ * persistent host visible buffer. The memory is reused once the command
+ * buffer has completed. Returns FALSE if the caller should create a separate
+ * staging bo instead. */
+BOOL wined3d_context_vk_get_staging_memory(struct wined3d_context_vk *context_vk, VkDeviceSize size,
+        VkDeviceSize alignment, struct wined3d_bo_address *address)
+{
+    struct wined3d_staging_ring_vk *ring = &context_vk->staging_ring;
+    uint64_t id = context_vk->current_command_buffer.id;
+    struct wined3d_staging_segment_vk *segment;
+    VkDeviceSize offset;
+    uint64_t wait_id;
+
+    TRACE("context_vk %p, size %s, alignment %s, address %p.\n", context_vk,
+            wine_dbgstr_longlong(size), wine_dbgstr_longlong(alignment), address);
+
+    if (size > WINED3D_STAGING_RING_SIZE_VK / 4)
+    {
+        ++ring->fallback_count;
+        return FALSE;
+    }
+
+    if (!ring->bo.vk_buffer && !wined3d_context_vk_create_bo(context_vk, WINED3D_STAGING_RING_SIZE_VK,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &ring->bo))
+    {
+        ERR("Failed to create staging ring bo.\n");
+        ring->bo.vk_buffer = VK_NULL_HANDLE;
+        return FALSE;
+    }
+
+    for (;;)
+    {
+        wined3d_context_vk_staging_ring_reclaim(context_vk);
+        if (wined3d_staging_ring_vk_find_space(ring, size, alignment, &offset))
+            break;
+
+        /* Everything in the ring is used by the current command buffer. */
+        if ((wait_id = ring->segments[0].command_buffer_id) == id)
+        {
+            ++ring->fallback_count;
+            return FALSE;
+        }
+
+        TRACE("Waiting for command buffer 0x%s.\n", wine_dbgstr_longlong(wait_id));
+        ++ring->stall_count;
+        wined3d_context_vk_wait_command_buffer(context_vk, wait_id);
+        if (context_vk->completed_command_buffer_id < wait_id)
+        {
+            ++ring->fallback_count;
+            return FALSE;
+        }
+    }
+
+    segment = ring->segment_count ? &ring->segments[ring->segment_count - 1] : NULL;
+    if (!segment || segment->command_buffer_id != id)
+    {
+        if (!wined3d_array_reserve((void **)&ring->segments, &ring->segments_size,
+                ring->segment_count + 1, sizeof(*ring->segments)))
+        {
+            ERR("Failed to grow staging segment array.\n");
+            ++ring->fallback_count;
+            return FALSE;
+        }
+        segment = &ring->segments[ring->segment_count++];
+        segment->command_buffer_id = id;
+    }
+    segment->end = offset + size;
+    ring->head = offset + size;
+
+    ring->upload_bytes += size;
+    ++ring->upload_count;
+
+    address->buffer_object = &ring->bo.b;
+    address->addr = (BYTE *)(uintptr_t)offset;
+
+    return TRUE;
+}
+
 void wined3d_context_vk_image_barrier(struct wined3d_context_vk *context_vk,
         VkCommandBuffer vk_command_buffer, VkPipelineStageFlags src_stage_mask, VkPipelineStageFlags dst_stage_mask,
         VkAccessFlags src_access_mask, VkAccessFlags dst_access_mask, VkImageLayout old_layout,
@@ -20,6 +20,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(d3d_sync);
 WINE_DECLARE_DEBUG_CHANNEL(fps);
 
@@ -110,6 +111,7 @@ enum wined3d_cs_op
     WINED3D_CS_OP_SET_RENDER_STATE,
     WINED3D_CS_OP_SET_TEXTURE_STATE,
     WINED3D_CS_OP_SET_SAMPLER_STATE,
+    WINED3D_CS_OP_SET_STATES,
     WINED3D_CS_OP_SET_TRANSFORM,
     WINED3D_CS_OP_SET_CLIP_PLANE,
     WINED3D_CS_OP_SET_COLOR_KEY,
@@ -360,6 +362,13 @@ struct wined3d_cs_set_sampler_state
     DWORD value;
 };
 
+struct wined3d_cs_set_states
+{
+    enum wined3d_cs_op opcode;
+    unsigned int count;
+    struct wined3d_state_value values[1];
+};
+
 struct wined3d_cs_set_transform
 {
     enum wined3d_cs_op opcode;
@@ -602,6 +611,7 @@ static const char *debug_cs_op(enum wined3d_cs_op op)
         WINED3D_TO_STR(WINED3D_CS_OP_SET_RENDER_STATE);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_TEXTURE_STATE);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_SAMPLER_STATE);
+        WINED3D_TO_STR(WINED3D_CS_OP_SET_STATES);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_TRANSFORM);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_CLIP_PLANE);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_COLOR_KEY);
@@ -1047,6 +1057,8 @@ static void wined3d_cs_exec_draw(struct wined3d_cs *cs, const void *data)
     const struct wined3d_cs_draw *op = data;
     unsigned int i;
 
+    ++cs->draw_count;
+
     base_vertex_idx = 0;
     if (!op->parameters.indirect)
     {
@@ -1940,6 +1952,49 @@ void wined3d_device_context_emit_set_sampler_state(struct wined3d_device_context
     wined3d_device_context_submit(context, WINED3D_CS_QUEUE_DEFAULT);
 }
 
+static void wined3d_cs_exec_set_states(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_set_states *op = data;
+    const struct wined3d_state_value *v;
+    unsigned int i;
+
+    for (i = 0; i < op->count; ++i)
+    {
+        v = &op->values[i];
+        switch (v->type)
+        {
+            case WINED3D_STATE_VALUE_RENDER:
+                cs->state.render_states[v->state] = v->value;
+                device_invalidate_state(cs->c.device, STATE_RENDER(v->state));
+                break;
+
+            case WINED3D_STATE_VALUE_TEXTURE:
+                cs->state.texture_states[v->idx][v->state] = v->value;
+                device_invalidate_state(cs->c.device, STATE_TEXTURESTAGE(v->idx, v->state));
+                break;
+
+            case WINED3D_STATE_VALUE_SAMPLER:
+                cs->state.sampler_states[v->idx][v->state] = v->value;
+                device_invalidate_state(cs->c.device, STATE_SAMPLER(v->idx));
+                break;
+        }
+    }
+}
+
+void wined3d_device_context_emit_set_states(struct wined3d_device_context *context,
+        unsigned int count, const struct wined3d_state_value *values)
+{
+    struct wined3d_cs_set_states *op;
+
+    op = wined3d_device_context_require_space(context, offsetof(struct wined3d_cs_set_states, values[count]),
+            WINED3D_CS_QUEUE_DEFAULT);
+    op->opcode = WINED3D_CS_OP_SET_STATES;
+    op->count = count;
+    memcpy(op->values, values, count * sizeof(*values));
+
+    wined3d_device_context_submit(context, WINED3D_CS_QUEUE_DEFAULT);
+}
+
 static void wined3d_cs_exec_set_transform(struct wined3d_cs *cs, const void *data)
 {
     const struct wined3d_cs_set_transform *op = data;
@@ -2997,6 +3052,7 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_SET_RENDER_STATE            */ wined3d_cs_exec_set_render_state,
     /* WINED3D_CS_OP_SET_TEXTURE_STATE           */ wined3d_cs_exec_set_texture_state,
     /* WINED3D_CS_OP_SET_SAMPLER_STATE           */ wined3d_cs_exec_set_sampler_state,
+    /* WINED3D_CS_OP_SET_STATES                  */ wined3d_cs_exec_set_states,
     /* WINED3D_CS_OP_SET_TRANSFORM               */ wined3d_cs_exec_set_transform,
     /* WINED3D_CS_OP_SET_CLIP_PLANE              */ wined3d_cs_exec_set_clip_plane,
     /* WINED3D_CS_OP_SET_COLOR_KEY               */ wined3d_cs_exec_set_color_key,
@@ -3211,20 +3267,89 @@ static const struct wined3d_device_context_ops wined3d_cs_st_ops =
 static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct wined3d_cs_queue *queue)
 {
     wined3d_from_cs(cs);
-    return *(volatile LONG *)&queue->head == queue->tail;
+    return *(volatile LONG *)&queue->head == queue->read;
+}
+
+/* Publish how far the CS thread got. Producers only look at the tail when
+ * they wait for space or for the queue to drain, so outside of that it's
+ * updated in batches to avoid bouncing its cache line on every packet. */
+static void wined3d_cs_queue_update_tail(struct wined3d_cs_queue *queue, LONG read)
+{
+    queue->read = read;
+
+    if (read != *(volatile LONG *)&queue->head && !*(volatile LONG *)&queue->waiters
+            && ((read - queue->tail) & (WINED3D_CS_QUEUE_SIZE - 1)) < WINED3D_CS_QUEUE_SIZE / 16)
+        return;
+
+    InterlockedExchange(&queue->tail, read);
+    if (*(volatile LONG *)&queue->waiters)
+        RtlWakeAddressAll(&queue->tail);
+}
+
+/* Wait for the CS thread to move the tail of "queue" away from "tail". */
+static void wined3d_cs_queue_wait(struct wined3d_cs_queue *queue, LONG tail)
+{
+    unsigned int spin_count = 0;
+    LARGE_INTEGER start, end;
+
+    if (*(volatile LONG *)&queue->tail != tail)
+        return;
+
+    if (TRACE_ON(d3d_perf))
+        QueryPerformanceCounter(&start);
+
+    while (*(volatile LONG *)&queue->tail == tail)
+    {
+        if (++spin_count < WINED3D_CS_PRODUCER_SPIN_COUNT)
+        {
+            YieldProcessor();
+            continue;
+        }
+
+        /* The CS thread checks "waiters" after updating the tail, and
+         * RtlWaitOnAddress() returns immediately if that already happened. */
+        InterlockedIncrement(&queue->waiters);
+        RtlWaitOnAddress(&queue->tail, &tail, sizeof(tail), NULL);
+        InterlockedDecrement(&queue->waiters);
+    }
+
+    if (TRACE_ON(d3d_perf))
+    {
+        QueryPerformanceCounter(&end);
+        queue->stall_time += end.QuadPart - start.QuadPart;
+        ++queue->stall_count;
+    }
 }
 
 static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined3d_cs *cs)
 {
     struct wined3d_cs_packet *packet;
     size_t packet_size;
+    LONG head;
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
     TRACE("Queuing op %s at %p.\n", debug_cs_op(*(const enum wined3d_cs_op *)packet->data), packet);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
-    InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
+    head = (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1);
+    /* Every packet is published individually. Holding back small packets
+     * would require every path that waits on the CS thread to flush them. */
+    InterlockedExchange(&queue->head, head);
+
+    if (TRACE_ON(d3d_perf))
+    {
+        /* Use the CS thread's read position rather than the tail, which lags
+         * behind by up to 1/16 of the queue. */
+        ULONG occupancy = (head - *(volatile LONG *)&queue->read) & (WINED3D_CS_QUEUE_SIZE - 1);
+
+        queue->max_occupancy = max(queue->max_occupancy, occupancy);
+        queue->occupancy_sum += occupancy;
+        ++queue->packet_count;
+    }
 
-    if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
+    /* The interlocked update of "head" above orders this read against the
+     * CS thread setting "waiting_for_event" before checking the queues. */
+    if (*(volatile BOOL *)&cs->waiting_for_event
+            && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         SetEvent(cs->event);
 }
 
@@ -3293,6 +3418,7 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
+        wined3d_cs_queue_wait(queue, tail);
     }
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
@@ -3315,11 +3441,15 @@ static void wined3d_cs_mt_finish(struct wined3d_device_context *context, enum wi
 {
     struct wined3d_cs *cs = wined3d_cs_from_context(context);
 
+    struct wined3d_cs_queue *queue;
+    LONG tail;
+
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(context, queue_id);
 
-    while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
-        YieldProcessor();
+    queue = &cs->queue[queue_id];
+    while (queue->head != (tail = *(volatile LONG *)&queue->tail))
+        wined3d_cs_queue_wait(queue, tail);
 }
 
 static const struct wined3d_device_context_ops wined3d_cs_mt_ops =
@@ -3427,7 +3557,7 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
         }
         spin_count = 0;
 
-        tail = queue->tail;
+        tail = queue->read;
         packet = wined3d_next_cs_packet(queue->data, &tail);
         if (packet->size)
         {
@@ -3447,12 +3577,11 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             TRACE("%s at %p executed.\n", debug_cs_op(opcode), packet);
         }
 
-        tail &= (WINED3D_CS_QUEUE_SIZE - 1);
-        InterlockedExchange(&queue->tail, tail);
+        wined3d_cs_queue_update_tail(queue, tail & (WINED3D_CS_QUEUE_SIZE - 1));
     }
 
-    cs->queue[WINED3D_CS_QUEUE_MAP].tail = cs->queue[WINED3D_CS_QUEUE_MAP].head;
-    cs->queue[WINED3D_CS_QUEUE_DEFAULT].tail = cs->queue[WINED3D_CS_QUEUE_DEFAULT].head;
+    wined3d_cs_queue_update_tail(&cs->queue[WINED3D_CS_QUEUE_MAP], cs->queue[WINED3D_CS_QUEUE_MAP].head);
+    wined3d_cs_queue_update_tail(&cs->queue[WINED3D_CS_QUEUE_DEFAULT], cs->queue[WINED3D_CS_QUEUE_DEFAULT].head);
     TRACE("Stopped.\n");
     FreeLibraryAndExitThread(wined3d_module, 0);
 }
@@ -3525,11 +3654,36 @@ fail:
     return NULL;
 }
 
+static void wined3d_cs_dump_queue_stats(const struct wined3d_cs *cs)
+{
+    unsigned int i, packet_count = 0;
+    const struct wined3d_cs_queue *queue;
+    LARGE_INTEGER freq;
+
+    QueryPerformanceFrequency(&freq);
+    for (i = 0; i < WINED3D_CS_QUEUE_COUNT; ++i)
+    {
+        queue = &cs->queue[i];
+        if (!queue->packet_count)
+            continue;
+        packet_count += queue->packet_count;
+        TRACE_(d3d_perf)("Queue %u: %u packets, average occupancy %s bytes, maximum %u bytes, "
+                "producers stalled %u times for %s ms.\n", i, queue->packet_count,
+                wine_dbgstr_longlong(queue->occupancy_sum / queue->packet_count), queue->max_occupancy,
+                queue->stall_count, wine_dbgstr_longlong(queue->stall_time * 1000 / freq.QuadPart));
+    }
+    if (cs->draw_count)
+        TRACE_(d3d_perf)("%u draws, %u.%02u packets per draw.\n", cs->draw_count, packet_count / cs->draw_count,
+                (unsigned int)((UINT64)(packet_count % cs->draw_count) * 100 / cs->draw_count));
+}
+
 void wined3d_cs_destroy(struct wined3d_cs *cs)
 {
     if (cs->thread)
     {
         wined3d_cs_emit_stop(cs);
+        if (TRACE_ON(d3d_perf))
+            wined3d_cs_dump_queue_stats(cs);
         CloseHandle(cs->thread);
         if (!CloseHandle(cs->event))
             ERR("Closing event failed.\n");
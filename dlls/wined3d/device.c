@@ -1588,8 +1588,40 @@ struct wined3d_rasterizer_state * CDECL wined3d_device_context_get_rasterizer_st
     return context->state->rasterizer_state;
 }
 
+/* Render, texture stage and sampler states changed by a stateblock are sent
+ * to the CS in a few packets instead of one packet per state. */
+struct wined3d_state_batch
+{
+    unsigned int count;
+    struct wined3d_state_value values[64];
+};
+
+static void wined3d_state_batch_flush(struct wined3d_device *device, struct wined3d_state_batch *batch)
+{
+    if (!batch->count)
+        return;
+
+    wined3d_device_context_emit_set_states(&device->cs->c, batch->count, batch->values);
+    batch->count = 0;
+}
+
+static void wined3d_state_batch_add(struct wined3d_device *device, struct wined3d_state_batch *batch,
+        enum wined3d_state_value_type type, unsigned int idx, unsigned int state, DWORD value)
+{
+    struct wined3d_state_value *v;
+
+    if (batch->count == ARRAY_SIZE(batch->values))
+        wined3d_state_batch_flush(device, batch);
+
+    v = &batch->values[batch->count++];
+    v->type = type;
+    v->idx = idx;
+    v->state = state;
+    v->value = value;
+}
+
 static void wined3d_device_set_render_state(struct wined3d_device *device,
-        enum wined3d_render_state state, DWORD value)
+        struct wined3d_state_batch *batch, enum wined3d_render_state state, DWORD value)
 {
     if (state > WINEHIGHEST_RENDER_STATE)
     {
@@ -1602,17 +1634,18 @@ static void wined3d_device_set_render_state(struct wined3d_device *device,
     else
     {
         device->cs->c.state->render_states[state] = value;
-        wined3d_device_context_emit_set_render_state(&device->cs->c, state, value);
+        wined3d_state_batch_add(device, batch, WINED3D_STATE_VALUE_RENDER, 0, state, value);
     }
 
     if (state == WINED3D_RS_POINTSIZE && value == WINED3D_RESZ_CODE)
     {
         TRACE("RESZ multisampled depth buffer resolve triggered.\n");
+        wined3d_state_batch_flush(device, batch);
         resolve_depth_buffer(device);
     }
 }
 
-static void wined3d_device_set_sampler_state(struct wined3d_device *device,
+static void wined3d_device_set_sampler_state(struct wined3d_device *device, struct wined3d_state_batch *batch,
         UINT sampler_idx, enum wined3d_sampler_state state, DWORD value)
 {
     TRACE("device %p, sampler_idx %u, state %s, value %#x.\n",
@@ -1625,7 +1658,7 @@ static void wined3d_device_set_sampler_state(struct wined3d_device *device,
     }
 
     device->cs->c.state->sampler_states[sampler_idx][state] = value;
-    wined3d_device_context_emit_set_sampler_state(&device->cs->c, sampler_idx, state, value);
+    wined3d_state_batch_add(device, batch, WINED3D_STATE_VALUE_SAMPLER, sampler_idx, state, value);
 }
 
 void CDECL wined3d_device_context_get_scissor_rects(const struct wined3d_device_context *context,
@@ -1937,6 +1970,13 @@ void CDECL wined3d_device_context_set_viewports(struct wined3d_device_context *c
     }
 
     wined3d_device_context_lock(context);
+    if (state->viewport_count == viewport_count
+            && !memcmp(state->viewports, viewports, viewport_count * sizeof(*viewports)))
+    {
+        TRACE("App is setting the old viewports over, nothing to do.\n");
+        goto out;
+    }
+
     if (viewport_count)
         memcpy(state->viewports, viewports, viewport_count * sizeof(*viewports));
     else
@@ -1944,6 +1984,7 @@ void CDECL wined3d_device_context_set_viewports(struct wined3d_device_context *c
     state->viewport_count = viewport_count;
 
     wined3d_device_context_emit_set_viewports(context, viewport_count, viewports);
+out:
     wined3d_device_context_unlock(context);
 }
 
@@ -3577,7 +3618,7 @@ HRESULT CDECL wined3d_device_process_vertices(struct wined3d_device *device,
     return hr;
 }
 
-static void wined3d_device_set_texture_stage_state(struct wined3d_device *device,
+static void wined3d_device_set_texture_stage_state(struct wined3d_device *device, struct wined3d_state_batch *batch,
         UINT stage, enum wined3d_texture_stage_state state, DWORD value)
 {
     const struct wined3d_d3d_info *d3d_info = &device->adapter->d3d_info;
@@ -3599,8 +3640,7 @@ static void wined3d_device_set_texture_stage_state(struct wined3d_device *device
     }
 
     device->cs->c.state->texture_states[stage][state] = value;
-
-    wined3d_device_context_emit_set_texture_state(&device->cs->c, stage, state, value);
+    wined3d_state_batch_add(device, batch, WINED3D_STATE_VALUE_TEXTURE, stage, state, value);
 }
 
 static void wined3d_device_set_texture(struct wined3d_device *device,
@@ -3647,12 +3687,15 @@ void CDECL wined3d_device_apply_stateblock(struct wined3d_device *device,
     const struct wined3d_saved_states *changed = &stateblock->changed;
     const unsigned int word_bit_count = sizeof(DWORD) * CHAR_BIT;
     struct wined3d_device_context *context = &device->cs->c;
+    struct wined3d_state_batch batch;
     unsigned int i, j, start, idx;
     struct wined3d_range range;
     uint32_t map;
 
     TRACE("device %p, stateblock %p.\n", device, stateblock);
 
+    batch.count = 0;
+
     if (changed->vertexShader)
         wined3d_device_context_set_shader(context, WINED3D_SHADER_TYPE_VERTEX, state->vs);
     if (changed->pixelShader)
@@ -3780,7 +3823,7 @@ void CDECL wined3d_device_apply_stateblock(struct wined3d_device *device,
                     break;
 
                 default:
-                    wined3d_device_set_render_state(device, idx, state->rs[idx]);
+                    wined3d_device_set_render_state(device, &batch, idx, state->rs[idx]);
                     break;
             }
         }
@@ -3973,7 +4016,7 @@ void CDECL wined3d_device_apply_stateblock(struct wined3d_device *device,
         while (map)
         {
             j = wined3d_bit_scan(&map);
-            wined3d_device_set_texture_stage_state(device, i, j, state->texture_states[i][j]);
+            wined3d_device_set_texture_stage_state(device, &batch, i, j, state->texture_states[i][j]);
         }
     }
 
@@ -3983,9 +4026,10 @@ void CDECL wined3d_device_apply_stateblock(struct wined3d_device *device,
         while (map)
         {
             j = wined3d_bit_scan(&map);
-            wined3d_device_set_sampler_state(device, i, j, state->sampler_states[i][j]);
+            wined3d_device_set_sampler_state(device, &batch, i, j, state->sampler_states[i][j]);
         }
     }
+    wined3d_state_batch_flush(device, &batch);
 
     if (changed->transforms)
     {
@@ -38,6 +38,7 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
 WINE_DECLARE_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 #define WINED3D_GLSL_SAMPLE_PROJECTED   0x01
@@ -124,6 +125,50 @@ struct constant_heap
 };
 
 /* GLSL shader private data */
+#define GLSL_PROGRAM_CACHE_MAGIC    0x43504757 /* "WGPC" */
+#define GLSL_PROGRAM_CACHE_VERSION  1
+#define GLSL_PROGRAM_CACHE_MAX_SIZE (64 * 1024 * 1024)
+
+struct glsl_program_binary
+{
+    struct wine_rb_entry entry;
+    UINT64 hash;
+    GLenum format;
+    GLsizei size;
+    BYTE data[1];
+};
+
+/* Linked program binaries, kept on disk across sessions. They're keyed by a
+ * hash of the sources of the attached shaders and of the parameters that
+ * affect linking, the driver is identified by the file header. */
+struct glsl_program_cache
+{
+    struct wine_rb_tree binaries;
+    char *path;
+    UINT64 driver_hash;
+    SIZE_T total_size;
+    BOOL dirty;
+
+    unsigned int hits, misses, failures;
+    LONGLONG link_time;
+};
+
+struct glsl_program_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    UINT64 driver_hash;
+    DWORD count;
+    DWORD padding;
+};
+
+struct glsl_program_cache_record
+{
+    UINT64 hash;
+    DWORD format;
+    DWORD size;
+};
+
 struct shader_glsl_priv
 {
     struct wined3d_string_buffer shader_buffer;
@@ -140,6 +185,11 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct glsl_program_cache program_cache;
+
+    LONGLONG compile_stall_time;
+    unsigned int compile_stall_count;
 };
 
 struct glsl_vs_program
@@ -548,10 +598,16 @@ void print_glsl_info_log(const struct wined3d_gl_info *gl_info, GLuint id, BOOL
     }
 }
 
+static BOOL shader_glsl_use_parallel_compile(const struct wined3d_gl_info *gl_info)
+{
+    return gl_info->supported[ARB_PARALLEL_SHADER_COMPILE] && wined3d_settings.shader_compiler_threads;
+}
+
 /* Context activation is done by the caller. */
 static void shader_glsl_compile(const struct wined3d_gl_info *gl_info, GLuint shader, const char *src)
 {
     const char *ptr, *line;
+    GLint status;
 
     TRACE("Compiling shader object %u.\n", shader);
 
@@ -565,6 +621,15 @@ static void shader_glsl_compile(const struct wined3d_gl_info *gl_info, GLuint sh
     checkGLcall("glShaderSource");
     GL_EXTCALL(glCompileShader(shader));
     checkGLcall("glCompileShader");
+    /* Querying the info log of a shader that is still being compiled waits
+     * for the compiler thread. The logs of such shaders are printed if the
+     * program they're linked into fails to link. */
+    if (shader_glsl_use_parallel_compile(gl_info) && !TRACE_ON(d3d_shader))
+    {
+        GL_EXTCALL(glGetShaderiv(shader, GL_COMPLETION_STATUS_ARB, &status));
+        if (!status)
+            return;
+    }
     print_glsl_info_log(gl_info, shader, FALSE);
 }
 
@@ -608,6 +673,7 @@ static void shader_glsl_dump_program_source(const struct wined3d_gl_info *gl_inf
         FIXME("    GL_SHADER_TYPE: %s.\n", debug_gl_shader_type(tmp));
         GL_EXTCALL(glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &tmp));
         FIXME("    GL_COMPILE_STATUS: %d.\n", tmp);
+        print_glsl_info_log(gl_info, shaders[i], FALSE);
         FIXME("\n");
 
         ptr = source;
@@ -6840,6 +6906,332 @@ static void shader_glsl_input_pack(const struct wined3d_shader *shader, struct w
     }
 }
 
+static int glsl_program_binary_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct glsl_program_binary *binary = WINE_RB_ENTRY_VALUE(entry, struct glsl_program_binary, entry);
+    UINT64 hash = *(const UINT64 *)key;
+
+    return hash < binary->hash ? -1 : hash > binary->hash;
+}
+
+static void glsl_program_binary_free(struct wine_rb_entry *entry, void *context)
+{
+    heap_free(WINE_RB_ENTRY_VALUE(entry, struct glsl_program_binary, entry));
+}
+
+static BOOL glsl_program_cache_add(struct glsl_program_cache *cache, UINT64 hash,
+        GLenum format, const void *data, GLsizei size)
+{
+    struct glsl_program_binary *binary;
+
+    if (cache->total_size + size > GLSL_PROGRAM_CACHE_MAX_SIZE)
+        return FALSE;
+    if (!(binary = heap_alloc(FIELD_OFFSET(struct glsl_program_binary, data[size]))))
+        return FALSE;
+    binary->hash = hash;
+    binary->format = format;
+    binary->size = size;
+    memcpy(binary->data, data, size);
+    if (wine_rb_put(&cache->binaries, &binary->hash, &binary->entry) == -1)
+    {
+        heap_free(binary);
+        return FALSE;
+    }
+    cache->total_size += size;
+    return TRUE;
+}
+
+static char *glsl_program_cache_get_path(void)
+{
+    char dir[MAX_PATH], exe[MAX_PATH], *name, *path;
+    DWORD len;
+
+    len = GetEnvironmentVariableA("LOCALAPPDATA", dir, ARRAY_SIZE(dir));
+    if (!len || len >= ARRAY_SIZE(dir) - sizeof("\\wined3d"))
+        return NULL;
+    strcat(dir, "\\wined3d");
+    if (!CreateDirectoryA(dir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+        return NULL;
+
+    len = GetModuleFileNameA(NULL, exe, ARRAY_SIZE(exe));
+    if (!len || len >= ARRAY_SIZE(exe))
+        return NULL;
+    name = (name = strrchr(exe, '\\')) ? name + 1 : exe;
+
+    if (!(path = heap_alloc(strlen(dir) + strlen(name) + sizeof("\\.glprog"))))
+        return NULL;
+    sprintf(path, "%s\\%s.glprog", dir, name);
+    return path;
+}
+
+static void glsl_program_cache_load(struct glsl_program_cache *cache)
+{
+    const struct glsl_program_cache_header *header;
+    const struct glsl_program_cache_record *record;
+    LARGE_INTEGER file_size;
+    BYTE *data = NULL;
+    unsigned int i;
+    SIZE_T offset;
+    HANDLE file;
+    DWORD size;
+
+    file = CreateFileA(cache->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < sizeof(*header)
+            || file_size.QuadPart > GLSL_PROGRAM_CACHE_MAX_SIZE * 2)
+        goto done;
+    size = file_size.QuadPart;
+    if (!(data = heap_alloc(size)) || !ReadFile(file, data, size, &size, NULL) || size != file_size.QuadPart)
+        goto done;
+
+    header = (const struct glsl_program_cache_header *)data;
+    if (header->magic != GLSL_PROGRAM_CACHE_MAGIC || header->version != GLSL_PROGRAM_CACHE_VERSION)
+    {
+        WARN("Ignoring invalid program cache %s.\n", debugstr_a(cache->path));
+        goto done;
+    }
+    if (header->driver_hash != cache->driver_hash)
+    {
+        TRACE("Program cache %s was created by a different driver.\n", debugstr_a(cache->path));
+        goto done;
+    }
+
+    for (i = 0, offset = sizeof(*header); i < header->count; ++i)
+    {
+        if (size - offset < sizeof(*record))
+            break;
+        record = (const struct glsl_program_cache_record *)(data + offset);
+        offset += sizeof(*record);
+        if (size - offset < record->size)
+            break;
+        if (!glsl_program_cache_add(cache, record->hash, record->format, data + offset, record->size))
+            break;
+        offset += (record->size + 7) & ~7;
+        offset = min(offset, size);
+    }
+    TRACE("Loaded %u program binaries, %lu bytes, from %s.\n", i, cache->total_size, debugstr_a(cache->path));
+
+done:
+    heap_free(data);
+    CloseHandle(file);
+}
+
+static void glsl_program_cache_save(struct glsl_program_cache *cache)
+{
+    static const BYTE padding[8];
+    struct glsl_program_cache_record record;
+    struct glsl_program_cache_header header;
+    struct glsl_program_binary *binary;
+    char *tmp_path;
+    BOOL ret = TRUE;
+    HANDLE file;
+    DWORD size;
+
+    if (!(tmp_path = heap_alloc(strlen(cache->path) + sizeof(".tmp"))))
+        return;
+    sprintf(tmp_path, "%s.tmp", cache->path);
+
+    file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_a(tmp_path), GetLastError());
+        heap_free(tmp_path);
+        return;
+    }
+
+    header.magic = GLSL_PROGRAM_CACHE_MAGIC;
+    header.version = GLSL_PROGRAM_CACHE_VERSION;
+    header.driver_hash = cache->driver_hash;
+    header.count = 0;
+    header.padding = 0;
+    WINE_RB_FOR_EACH_ENTRY(binary, &cache->binaries, struct glsl_program_binary, entry)
+        ++header.count;
+    ret = WriteFile(file, &header, sizeof(header), &size, NULL);
+
+    WINE_RB_FOR_EACH_ENTRY(binary, &cache->binaries, struct glsl_program_binary, entry)
+    {
+        if (!ret)
+            break;
+        record.hash = binary->hash;
+        record.format = binary->format;
+        record.size = binary->size;
+        ret = WriteFile(file, &record, sizeof(record), &size, NULL)
+                && WriteFile(file, binary->data, binary->size, &size, NULL)
+                && WriteFile(file, padding, -binary->size & 7, &size, NULL);
+    }
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExA(tmp_path, cache->path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write program cache %s, error %u.\n", debugstr_a(cache->path), GetLastError());
+        DeleteFileA(tmp_path);
+    }
+    else
+    {
+        cache->dirty = FALSE;
+    }
+    heap_free(tmp_path);
+}
+
+static void glsl_program_cache_init(struct glsl_program_cache *cache, const struct wined3d_gl_info *gl_info)
+{
+    wine_rb_init(&cache->binaries, glsl_program_binary_compare);
+
+    if (!wined3d_settings.program_cache || !gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        return;
+    if (!(cache->path = glsl_program_cache_get_path()))
+        return;
+    cache->driver_hash = gl_info->driver_hash;
+    glsl_program_cache_load(cache);
+}
+
+static void glsl_program_cache_cleanup(struct glsl_program_cache *cache)
+{
+    if (cache->path)
+    {
+        TRACE_(d3d_perf)("Program cache: %u hits, %u misses, %u failed loads, %s ms linking, %lu bytes.\n",
+                cache->hits, cache->misses, cache->failures,
+                wine_dbgstr_longlong(cache->link_time / 10000), cache->total_size);
+        if (cache->dirty)
+            glsl_program_cache_save(cache);
+    }
+    wine_rb_destroy(&cache->binaries, glsl_program_binary_free, NULL);
+    heap_free(cache->path);
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_get_program_hash(const struct wined3d_gl_info *gl_info,
+        GLuint program_id, DWORD link_params, UINT64 *hash)
+{
+    GLint i, shader_count, source_size = 0, length;
+    UINT64 shader_hash = 0;
+    GLuint shaders[8];
+    char *source = NULL;
+    GLint type;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_ATTACHED_SHADERS, &shader_count));
+    if (shader_count > ARRAY_SIZE(shaders))
+        return FALSE;
+    GL_EXTCALL(glGetAttachedShaders(program_id, shader_count, NULL, shaders));
+
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (length > source_size)
+        {
+            heap_free(source);
+            if (!(source = heap_alloc(length)))
+                return FALSE;
+            source_size = length;
+        }
+        GL_EXTCALL(glGetShaderSource(shaders[i], source_size, &length, source));
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type));
+        /* The order of attached shaders isn't defined, so combine the
+         * individual hashes in an order independent way. */
+        shader_hash += wined3d_hash_data(wined3d_hash_data(0, &type, sizeof(type)), source, length);
+    }
+    heap_free(source);
+
+    *hash = wined3d_hash_data(0, &link_params, sizeof(link_params));
+    *hash = wined3d_hash_data(*hash, &shader_hash, sizeof(shader_hash));
+    return TRUE;
+}
+
+/* With GL_ARB_parallel_shader_compile, the link completes in the background.
+ * Wait for it, recording how long the CS thread was blocked.
+ * Context activation is done by the caller. */
+static void shader_glsl_wait_link(struct shader_glsl_priv *priv, const struct wined3d_gl_info *gl_info,
+        GLuint program_id)
+{
+    LARGE_INTEGER start, end, freq;
+    GLint status;
+
+    if (!shader_glsl_use_parallel_compile(gl_info))
+        return;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_COMPLETION_STATUS_ARB, &status));
+    if (status)
+        return;
+
+    /* Querying the link status blocks until the link is complete. */
+    QueryPerformanceCounter(&start);
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    QueryPerformanceCounter(&end);
+    QueryPerformanceFrequency(&freq);
+    end.QuadPart = (end.QuadPart - start.QuadPart) * 10000000 / freq.QuadPart;
+    TRACE_(d3d_perf)("Waited %s us for program %u.\n", wine_dbgstr_longlong(end.QuadPart / 10), program_id);
+    priv->compile_stall_time += end.QuadPart;
+    ++priv->compile_stall_count;
+}
+
+/* Link a program, or load its binary from the program cache. "link_params"
+ * should identify any state that affects linking besides the shader sources.
+ * Context activation is done by the caller. */
+static void shader_glsl_link_program(struct shader_glsl_priv *priv, const struct wined3d_gl_info *gl_info,
+        GLuint program_id, DWORD link_params, BOOL cacheable)
+{
+    struct glsl_program_cache *cache = &priv->program_cache;
+    struct glsl_program_binary *binary;
+    LARGE_INTEGER start, end, freq;
+    struct wine_rb_entry *entry;
+    GLint status, size;
+    GLenum format;
+    UINT64 hash;
+    void *data;
+
+    if (!cache->path || !cacheable || !shader_glsl_get_program_hash(gl_info, program_id, link_params, &hash))
+    {
+        GL_EXTCALL(glLinkProgram(program_id));
+        shader_glsl_wait_link(priv, gl_info, program_id);
+        shader_glsl_validate_link(gl_info, program_id);
+        return;
+    }
+
+    if ((entry = wine_rb_get(&cache->binaries, &hash)))
+    {
+        binary = WINE_RB_ENTRY_VALUE(entry, struct glsl_program_binary, entry);
+        GL_EXTCALL(glProgramBinary(program_id, binary->format, binary->data, binary->size));
+        GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+        if (status)
+        {
+            TRACE("Loaded program %u from binary %s.\n", program_id, wine_dbgstr_longlong(hash));
+            ++cache->hits;
+            return;
+        }
+        /* The driver may reject binaries for any reason, e.g. after an update. */
+        WARN("Failed to load binary %s for program %u.\n", wine_dbgstr_longlong(hash), program_id);
+        wine_rb_remove(&cache->binaries, entry);
+        cache->total_size -= binary->size;
+        heap_free(binary);
+        cache->dirty = TRUE;
+        ++cache->failures;
+    }
+    ++cache->misses;
+
+    GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    QueryPerformanceCounter(&start);
+    GL_EXTCALL(glLinkProgram(program_id));
+    shader_glsl_wait_link(priv, gl_info, program_id);
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    QueryPerformanceCounter(&end);
+    QueryPerformanceFrequency(&freq);
+    cache->link_time += (end.QuadPart - start.QuadPart) * 10000000 / freq.QuadPart;
+    shader_glsl_validate_link(gl_info, program_id);
+    if (!status)
+        return;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &size));
+    if (size <= 0 || !(data = heap_alloc(size)))
+        return;
+    GL_EXTCALL(glGetProgramBinary(program_id, size, &size, &format, data));
+    checkGLcall("glGetProgramBinary");
+    if (size > 0 && glsl_program_cache_add(cache, hash, format, data, size))
+        cache->dirty = TRUE;
+    heap_free(data);
+}
+
 static void add_glsl_program_entry(struct shader_glsl_priv *priv, struct glsl_shader_prog_link *entry)
 {
     struct glsl_program_key key;
@@ -10157,8 +10549,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
     TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(priv, gl_info, program_id, 0, TRUE);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10239,6 +10630,8 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     GLuint gs_id = 0;
     GLuint ps_id = 0;
     struct list *ps_list, *vs_list;
+    DWORD link_params = 0;
+    BOOL cacheable = TRUE;
     WORD attribs_map;
     struct wined3d_string_buffer *tmp_name;
 
@@ -10407,6 +10800,12 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
 
     if (!shader_glsl_use_explicit_attrib_location(gl_info))
     {
+        link_params = attribs_map;
+        if (vshader && vshader->reg_maps.shader_version.major >= 4)
+            link_params |= 0x10000;
+        if (!use_legacy_fragment_output(gl_info) && state->blend_state && state->blend_state->dual_source)
+            link_params |= 0x20000;
+
         /* Bind vertex attributes to a corresponding index number to match
          * the same index numbers as ARB_vertex_programs (makes loading
          * vertex attributes simpler). With this method, we can use the
@@ -10474,6 +10873,8 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
         checkGLcall("glAttachShader");
 
         shader_glsl_init_transform_feedback(context_gl, priv, program_id, gshader);
+        if (gshader->u.gs.so_desc)
+            cacheable = FALSE;
 
         list_add_head(&gshader->linked_programs, &entry->gs.shader_entry);
     }
@@ -10490,8 +10891,7 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
 
     /* Link the program */
     TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(priv, gl_info, program_id, link_params, cacheable);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -10648,14 +11048,28 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
 static void shader_glsl_precompile(void *shader_priv, struct wined3d_shader *shader)
 {
     struct wined3d_device *device = shader->device;
+    enum wined3d_shader_type type = shader->reg_maps.shader_version.type;
     struct wined3d_context *context;
 
-    if (shader->reg_maps.shader_version.type == WINED3D_SHADER_TYPE_COMPUTE)
+    /* Compute and hull shaders only have a single variant, so it can be
+     * compiled upfront. The variants of the other shader types depend on
+     * state that is only known at draw time; compiling a guess from the
+     * current state here would mostly waste CS thread time on variants
+     * that are never used. */
+    if (type != WINED3D_SHADER_TYPE_COMPUTE && (type != WINED3D_SHADER_TYPE_HULL
+            || !shader_glsl_use_parallel_compile(&device->adapter->gl_info)))
+        return;
+
+    if (!(context = context_acquire(device, NULL, 0)))
     {
-        context = context_acquire(device, NULL, 0);
-        shader_glsl_compile_compute_shader(shader_priv, wined3d_context_gl(context), shader);
-        context_release(context);
+        WARN("Failed to acquire context.\n");
+        return;
     }
+    if (type == WINED3D_SHADER_TYPE_COMPUTE)
+        shader_glsl_compile_compute_shader(shader_priv, wined3d_context_gl(context), shader);
+    else
+        find_glsl_hull_shader(wined3d_context_gl(context), shader_priv, shader);
+    context_release(context);
 }
 
 /* Context activation is done by the caller. */
@@ -11081,6 +11495,7 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     }
 
     wine_rb_init(&priv->program_lookup, glsl_program_key_compare);
+    glsl_program_cache_init(&priv->program_cache, &device->adapter->gl_info);
 
     priv->next_constant_version = 1;
     priv->vertex_pipe = vertex_pipe;
@@ -11112,6 +11527,9 @@ static void shader_glsl_free(struct wined3d_device *device, struct wined3d_conte
     struct shader_glsl_priv *priv = device->shader_priv;
 
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
+    glsl_program_cache_cleanup(&priv->program_cache);
+    TRACE_(d3d_perf)("Waited %s ms for %u programs to link.\n",
+            wine_dbgstr_longlong(priv->compile_stall_time / 10000), priv->compile_stall_count);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
     heap_free(priv->stack);
@@ -30,6 +30,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 
 const struct wined3d_vec4 wined3d_srgb_const[] =
 {
@@ -1875,6 +1876,370 @@ static void shader_cleanup_reg_maps(struct wined3d_shader_reg_maps *reg_maps)
     heap_free(reg_maps->tgsm);
 }
 
+#define WINED3D_SHADER_PARSE_CACHE_SIZE 1024
+
+/* The results of shader_get_registers_used() for recently created shaders,
+ * keyed by their byte code. Applications that recreate the same shaders, e.g.
+ * on every level load, can then skip scanning the byte code again. */
+struct wined3d_shader_parse_cache_key
+{
+    UINT64 hash;
+    enum wined3d_shader_type type;
+    unsigned int float_const_count;
+    const void *byte_code;
+    unsigned int byte_code_size;
+    unsigned int function_offset;
+    unsigned int function_size;
+};
+
+struct wined3d_shader_parse_cache_entry
+{
+    struct wine_rb_entry entry;
+    struct list lru_entry;
+    struct wined3d_shader_parse_cache_key key;
+
+    struct wined3d_shader_reg_maps reg_maps;
+    unsigned int constf_count;
+    struct list constants_b;
+    struct list constants_f;
+    struct list constants_i;
+    BOOL lconst_inf_or_nan;
+    /* Only the signatures built from the declarations are stored. */
+    struct wined3d_shader_signature input_signature;
+    struct wined3d_shader_signature output_signature;
+    union
+    {
+        struct wined3d_domain_shader ds;
+        struct wined3d_geometry_shader gs;
+        struct wined3d_pixel_shader ps;
+        struct wined3d_compute_shader cs;
+    } u;
+};
+
+static int wined3d_shader_parse_cache_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct wined3d_shader_parse_cache_entry *e = WINE_RB_ENTRY_VALUE(entry,
+            struct wined3d_shader_parse_cache_entry, entry);
+    const struct wined3d_shader_parse_cache_key *k = key;
+
+    if (k->hash != e->key.hash)
+        return k->hash < e->key.hash ? -1 : 1;
+    if (k->type != e->key.type)
+        return k->type < e->key.type ? -1 : 1;
+    if (k->float_const_count != e->key.float_const_count)
+        return k->float_const_count < e->key.float_const_count ? -1 : 1;
+    if (k->byte_code_size != e->key.byte_code_size)
+        return k->byte_code_size < e->key.byte_code_size ? -1 : 1;
+    if (k->function_offset != e->key.function_offset)
+        return k->function_offset < e->key.function_offset ? -1 : 1;
+    if (k->function_size != e->key.function_size)
+        return k->function_size < e->key.function_size ? -1 : 1;
+    return memcmp(k->byte_code, e->key.byte_code, k->byte_code_size);
+}
+
+static struct
+{
+    struct wine_rb_tree tree;
+    struct list lru;
+    unsigned int count;
+    unsigned int hit_count, miss_count;
+}
+shader_parse_cache =
+{
+    {wined3d_shader_parse_cache_compare},
+    LIST_INIT(shader_parse_cache.lru),
+};
+
+static CRITICAL_SECTION shader_parse_cache_cs;
+static CRITICAL_SECTION_DEBUG shader_parse_cache_cs_debug =
+{
+    0, 0, &shader_parse_cache_cs,
+    {&shader_parse_cache_cs_debug.ProcessLocksList,
+    &shader_parse_cache_cs_debug.ProcessLocksList},
+    0, 0, {(DWORD_PTR)(__FILE__ ": shader_parse_cache_cs")}
+};
+static CRITICAL_SECTION shader_parse_cache_cs = {&shader_parse_cache_cs_debug, -1, 0, 0, 0, 0};
+
+static BOOL shader_parse_cache_key_init(struct wined3d_shader_parse_cache_key *key,
+        const struct wined3d_shader *shader, enum wined3d_shader_type type, unsigned int float_const_count)
+{
+    /* Hull shader phases and immediate constant buffers reference the
+     * frontend data of the shader they were parsed from. */
+    if (type == WINED3D_SHADER_TYPE_HULL || !shader->byte_code)
+        return FALSE;
+
+    key->type = type;
+    key->float_const_count = float_const_count;
+    key->byte_code = shader->byte_code;
+    key->byte_code_size = shader->byte_code_size;
+    key->function_offset = (const BYTE *)shader->function - (const BYTE *)shader->byte_code;
+    key->function_size = shader->functionLength;
+    key->hash = wined3d_hash_data(0, &key->type, sizeof(key->type));
+    key->hash = wined3d_hash_data(key->hash, &key->float_const_count, sizeof(key->float_const_count));
+    key->hash = wined3d_hash_data(key->hash, &key->function_offset, sizeof(key->function_offset));
+    key->hash = wined3d_hash_data(key->hash, &key->function_size, sizeof(key->function_size));
+    key->hash = wined3d_hash_data(key->hash, key->byte_code, key->byte_code_size);
+
+    return TRUE;
+}
+
+static BOOL shader_copy_constant_list(struct list *dst, const struct list *src)
+{
+    const struct wined3d_shader_lconst *constant;
+    struct wined3d_shader_lconst *copy;
+
+    LIST_FOR_EACH_ENTRY(constant, src, const struct wined3d_shader_lconst, entry)
+    {
+        if (!(copy = heap_alloc(sizeof(*copy))))
+            return FALSE;
+        *copy = *constant;
+        list_add_tail(dst, &copy->entry);
+    }
+
+    return TRUE;
+}
+
+static BOOL shader_copy_signature(struct wined3d_shader_signature *dst, const struct wined3d_shader_signature *src)
+{
+    if (!src->element_count)
+        return TRUE;
+
+    if (!(dst->elements = heap_calloc(src->element_count, sizeof(*dst->elements))))
+        return FALSE;
+    memcpy(dst->elements, src->elements, src->element_count * sizeof(*dst->elements));
+    dst->element_count = src->element_count;
+
+    return TRUE;
+}
+
+/* "dst" can be passed to shader_cleanup_reg_maps() even if this fails. */
+static BOOL shader_copy_reg_maps(struct wined3d_shader_reg_maps *dst,
+        const struct wined3d_shader_reg_maps *src, unsigned int constf_count)
+{
+    const struct wined3d_shader_indexable_temp *reg;
+    struct wined3d_shader_indexable_temp *copy;
+
+    *dst = *src;
+    dst->constf = NULL;
+    dst->sampler_map.entries = NULL;
+    dst->sampler_map.size = dst->sampler_map.count = 0;
+    dst->tgsm = NULL;
+    dst->tgsm_capacity = dst->tgsm_count = 0;
+    list_init(&dst->indexable_temps);
+
+    if (!(dst->constf = heap_calloc(constf_count, sizeof(*dst->constf))))
+        return FALSE;
+    memcpy(dst->constf, src->constf, constf_count * sizeof(*dst->constf));
+
+    if (src->sampler_map.count)
+    {
+        if (!(dst->sampler_map.entries = heap_calloc(src->sampler_map.count, sizeof(*dst->sampler_map.entries))))
+            return FALSE;
+        memcpy(dst->sampler_map.entries, src->sampler_map.entries,
+                src->sampler_map.count * sizeof(*dst->sampler_map.entries));
+        dst->sampler_map.size = dst->sampler_map.count = src->sampler_map.count;
+    }
+
+    if (src->tgsm_count)
+    {
+        if (!(dst->tgsm = heap_calloc(src->tgsm_count, sizeof(*dst->tgsm))))
+            return FALSE;
+        memcpy(dst->tgsm, src->tgsm, src->tgsm_count * sizeof(*dst->tgsm));
+        dst->tgsm_capacity = dst->tgsm_count = src->tgsm_count;
+    }
+
+    LIST_FOR_EACH_ENTRY(reg, &src->indexable_temps, const struct wined3d_shader_indexable_temp, entry)
+    {
+        if (!(copy = heap_alloc(sizeof(*copy))))
+            return FALSE;
+        *copy = *reg;
+        list_add_tail(&dst->indexable_temps, &copy->entry);
+    }
+
+    return TRUE;
+}
+
+static void shader_parse_cache_entry_destroy(struct wined3d_shader_parse_cache_entry *entry)
+{
+    shader_cleanup_reg_maps(&entry->reg_maps);
+    shader_delete_constant_list(&entry->constants_b);
+    shader_delete_constant_list(&entry->constants_f);
+    shader_delete_constant_list(&entry->constants_i);
+    heap_free(entry->input_signature.elements);
+    heap_free(entry->output_signature.elements);
+    heap_free((void *)entry->key.byte_code);
+    heap_free(entry);
+}
+
+/* Fills in the results of shader_get_registers_used() from the cache.
+ * Returns S_FALSE if the shader isn't in the cache. */
+static HRESULT shader_parse_cache_get(struct wined3d_shader *shader,
+        enum wined3d_shader_type type, unsigned int float_const_count)
+{
+    struct wined3d_shader_parse_cache_entry *entry;
+    struct wined3d_shader_parse_cache_key key;
+    struct wine_rb_entry *rb_entry;
+    HRESULT hr = E_OUTOFMEMORY;
+
+    if (!shader_parse_cache_key_init(&key, shader, type, float_const_count))
+        return S_FALSE;
+
+    EnterCriticalSection(&shader_parse_cache_cs);
+
+    if (!(rb_entry = wine_rb_get(&shader_parse_cache.tree, &key)))
+    {
+        ++shader_parse_cache.miss_count;
+        LeaveCriticalSection(&shader_parse_cache_cs);
+        return S_FALSE;
+    }
+    entry = WINE_RB_ENTRY_VALUE(rb_entry, struct wined3d_shader_parse_cache_entry, entry);
+
+    /* On failure, shader_cleanup() frees whatever was copied so far. */
+    if (!shader_copy_reg_maps(&shader->reg_maps, &entry->reg_maps, entry->constf_count)
+            || !shader_copy_constant_list(&shader->constantsB, &entry->constants_b)
+            || !shader_copy_constant_list(&shader->constantsF, &entry->constants_f)
+            || !shader_copy_constant_list(&shader->constantsI, &entry->constants_i)
+            || !shader_copy_signature(&shader->input_signature, &entry->input_signature)
+            || !shader_copy_signature(&shader->output_signature, &entry->output_signature))
+        goto done;
+
+    shader->lconst_inf_or_nan = entry->lconst_inf_or_nan;
+    switch (type)
+    {
+        case WINED3D_SHADER_TYPE_DOMAIN:
+            shader->u.ds = entry->u.ds;
+            break;
+        case WINED3D_SHADER_TYPE_GEOMETRY:
+            /* The stream output description is set before parsing. */
+            shader->u.gs.input_type = entry->u.gs.input_type;
+            shader->u.gs.output_type = entry->u.gs.output_type;
+            shader->u.gs.vertices_out = entry->u.gs.vertices_out;
+            shader->u.gs.instance_count = entry->u.gs.instance_count;
+            break;
+        case WINED3D_SHADER_TYPE_PIXEL:
+            shader->u.ps = entry->u.ps;
+            break;
+        case WINED3D_SHADER_TYPE_COMPUTE:
+            shader->u.cs = entry->u.cs;
+            break;
+        default:
+            break;
+    }
+    shader_set_limits(shader);
+
+    list_remove(&entry->lru_entry);
+    list_add_head(&shader_parse_cache.lru, &entry->lru_entry);
+    ++shader_parse_cache.hit_count;
+    hr = WINED3D_OK;
+
+done:
+    LeaveCriticalSection(&shader_parse_cache_cs);
+    return hr;
+}
+
+/* Stores the results of shader_get_registers_used(). Signatures that were
+ * already present before parsing come from the DXBC container and aren't
+ * stored; they are part of the byte code used as key. */
+static void shader_parse_cache_put(const struct wined3d_shader *shader, enum wined3d_shader_type type,
+        unsigned int float_const_count, BOOL parsed_input_signature, BOOL parsed_output_signature)
+{
+    struct wined3d_shader_parse_cache_entry *entry;
+    struct wined3d_shader_parse_cache_key key;
+    void *byte_code;
+
+    if (shader->reg_maps.icb || !shader_parse_cache_key_init(&key, shader, type, float_const_count))
+        return;
+
+    if (!(entry = heap_alloc_zero(sizeof(*entry))))
+        return;
+    list_init(&entry->reg_maps.indexable_temps);
+    list_init(&entry->constants_b);
+    list_init(&entry->constants_f);
+    list_init(&entry->constants_i);
+
+    entry->key = key;
+    entry->key.byte_code = NULL;
+    if (!(byte_code = heap_alloc(key.byte_code_size)))
+    {
+        shader_parse_cache_entry_destroy(entry);
+        return;
+    }
+    memcpy(byte_code, key.byte_code, key.byte_code_size);
+    entry->key.byte_code = byte_code;
+
+    entry->constf_count = (min(shader->limits->constant_float, float_const_count) + 31) / 32;
+    if (!shader_copy_reg_maps(&entry->reg_maps, &shader->reg_maps, entry->constf_count)
+            || !shader_copy_constant_list(&entry->constants_b, &shader->constantsB)
+            || !shader_copy_constant_list(&entry->constants_f, &shader->constantsF)
+            || !shader_copy_constant_list(&entry->constants_i, &shader->constantsI)
+            || (parsed_input_signature && !shader_copy_signature(&entry->input_signature, &shader->input_signature))
+            || (parsed_output_signature
+            && !shader_copy_signature(&entry->output_signature, &shader->output_signature)))
+    {
+        shader_parse_cache_entry_destroy(entry);
+        return;
+    }
+
+    entry->lconst_inf_or_nan = shader->lconst_inf_or_nan;
+    switch (type)
+    {
+        case WINED3D_SHADER_TYPE_DOMAIN:
+            entry->u.ds = shader->u.ds;
+            break;
+        case WINED3D_SHADER_TYPE_GEOMETRY:
+            entry->u.gs = shader->u.gs;
+            entry->u.gs.so_desc = NULL;
+            break;
+        case WINED3D_SHADER_TYPE_PIXEL:
+            entry->u.ps = shader->u.ps;
+            break;
+        case WINED3D_SHADER_TYPE_COMPUTE:
+            entry->u.cs = shader->u.cs;
+            break;
+        default:
+            break;
+    }
+
+    EnterCriticalSection(&shader_parse_cache_cs);
+
+    if (wine_rb_put(&shader_parse_cache.tree, &entry->key, &entry->entry) == -1)
+    {
+        /* Another thread created the same shader in the meantime. */
+        LeaveCriticalSection(&shader_parse_cache_cs);
+        shader_parse_cache_entry_destroy(entry);
+        return;
+    }
+    list_add_head(&shader_parse_cache.lru, &entry->lru_entry);
+
+    if (++shader_parse_cache.count > WINED3D_SHADER_PARSE_CACHE_SIZE)
+    {
+        entry = LIST_ENTRY(list_tail(&shader_parse_cache.lru), struct wined3d_shader_parse_cache_entry, lru_entry);
+        wine_rb_remove(&shader_parse_cache.tree, &entry->entry);
+        list_remove(&entry->lru_entry);
+        --shader_parse_cache.count;
+        shader_parse_cache_entry_destroy(entry);
+    }
+
+    LeaveCriticalSection(&shader_parse_cache_cs);
+}
+
+void wined3d_shader_parse_cache_cleanup(void)
+{
+    struct wined3d_shader_parse_cache_entry *entry, *entry_next;
+
+    TRACE_(d3d_perf)("Shader parse cache: %u hits, %u misses, %u entries.\n",
+            shader_parse_cache.hit_count, shader_parse_cache.miss_count, shader_parse_cache.count);
+
+    LIST_FOR_EACH_ENTRY_SAFE(entry, entry_next, &shader_parse_cache.lru,
+            struct wined3d_shader_parse_cache_entry, lru_entry)
+        shader_parse_cache_entry_destroy(entry);
+    list_init(&shader_parse_cache.lru);
+    wine_rb_init(&shader_parse_cache.tree, wined3d_shader_parse_cache_compare);
+    shader_parse_cache.count = 0;
+
+    DeleteCriticalSection(&shader_parse_cache_cs);
+}
+
 unsigned int shader_find_free_input_register(const struct wined3d_shader_reg_maps *reg_maps, unsigned int max)
 {
     DWORD map = 1u << max;
@@ -3332,6 +3697,7 @@ static HRESULT shader_set_function(struct wined3d_shader *shader, struct wined3d
     const struct wined3d_d3d_info *d3d_info = &shader->device->adapter->d3d_info;
     struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
     const struct wined3d_shader_version *version = &reg_maps->shader_version;
+    BOOL parsed_input_signature, parsed_output_signature;
     const struct wined3d_shader_frontend *fe;
     unsigned int backend_version;
     HRESULT hr;
@@ -3352,7 +3718,15 @@ static HRESULT shader_set_function(struct wined3d_shader *shader, struct wined3d
         shader_trace_init(fe, shader->frontend_data);
 
     /* Second pass: figure out which registers are used, what the semantics are, etc. */
-    if (FAILED(hr = shader_get_registers_used(shader, float_const_count)))
+    if ((hr = shader_parse_cache_get(shader, type, float_const_count)) == S_FALSE)
+    {
+        parsed_input_signature = !shader->input_signature.elements;
+        parsed_output_signature = !shader->output_signature.elements;
+        if (SUCCEEDED(hr = shader_get_registers_used(shader, float_const_count)))
+            shader_parse_cache_put(shader, type, float_const_count,
+                    parsed_input_signature, parsed_output_signature);
+    }
+    if (FAILED(hr))
         return hr;
 
     if (version->type != type)
@@ -28,6 +28,9 @@
 
 #include "config.h"
 #include "wined3d_private.h"
+#ifdef WINED3D_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
@@ -125,6 +128,38 @@ static void convert_r32_float_r16_float(const BYTE *src, BYTE *dst,
     }
 }
 
+#ifdef WINED3D_HAVE_SSE2
+/* Converts 8 pixels at a time, and returns the number of pixels converted.
+ * (x * 527 + 23) >> 6 and (x * 259 + 33) >> 6 give the same results as the
+ * tables in convert_r5g6b5_x8r8g8b8(). */
+static WINED3D_SSE2_TARGET unsigned int convert_r5g6b5_x8r8g8b8_sse2(const WORD *src, DWORD *dst, unsigned int w)
+{
+    const __m128i mask_5 = _mm_set1_epi16(0x1f), mask_6 = _mm_set1_epi16(0x3f);
+    const __m128i mul_5 = _mm_set1_epi16(527), add_5 = _mm_set1_epi16(23);
+    const __m128i mul_6 = _mm_set1_epi16(259), add_6 = _mm_set1_epi16(33);
+    const __m128i alpha = _mm_set1_epi16(0xff00);
+    __m128i pixel, r, g, b, bg, ra;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= w; x += 8)
+    {
+        pixel = _mm_loadu_si128((const __m128i *)&src[x]);
+        r = _mm_srli_epi16(pixel, 11);
+        g = _mm_and_si128(_mm_srli_epi16(pixel, 5), mask_6);
+        b = _mm_and_si128(pixel, mask_5);
+        r = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(r, mul_5), add_5), 6);
+        g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, mul_6), add_6), 6);
+        b = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(b, mul_5), add_5), 6);
+        bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        ra = _mm_or_si128(r, alpha);
+        _mm_storeu_si128((__m128i *)&dst[x], _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)&dst[x + 4], _mm_unpackhi_epi16(bg, ra));
+    }
+
+    return x;
+}
+#endif
+
 static void convert_r5g6b5_x8r8g8b8(const BYTE *src, BYTE *dst,
         DWORD pitch_in, DWORD pitch_out, unsigned int w, unsigned int h)
 {
@@ -147,6 +182,9 @@ static void convert_r5g6b5_x8r8g8b8(const BYTE *src, BYTE *dst,
         0xe3, 0xe7, 0xeb, 0xef, 0xf3, 0xf7, 0xfb, 0xff,
     };
     unsigned int x, y;
+#ifdef WINED3D_HAVE_SSE2
+    BOOL sse2 = wined3d_use_sse2();
+#endif
 
     TRACE("Converting %ux%u pixels, pitches %u %u.\n", w, h, pitch_in, pitch_out);
 
@@ -154,7 +192,13 @@ static void convert_r5g6b5_x8r8g8b8(const BYTE *src, BYTE *dst,
     {
         const WORD *src_line = (const WORD *)(src + y * pitch_in);
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+
+#ifdef WINED3D_HAVE_SSE2
+        x = sse2 ? convert_r5g6b5_x8r8g8b8_sse2(src_line, dst_line, w) : 0;
+#else
+        x = 0;
+#endif
+        for (; x < w; ++x)
         {
             WORD pixel = src_line[x];
             dst_line[x] = 0xff000000u
@@ -191,11 +235,90 @@ static inline BYTE cliptobyte(int x)
     return (BYTE)((x < 0) ? 0 : ((x > 255) ? 255 : x));
 }
 
+#ifdef WINED3D_HAVE_SSE2
+/* Computes the clipped RGB values of the 4 pixels in "yuyv", which holds
+ * Y0 U Y1 V Y2 U Y3 V as 16-bit values, in the 32-bit lanes of "r", "g" and
+ * "b". The shuffles pair each Y with the U and V of its pixel pair, so that
+ * _mm_madd_epi16() computes the same sums as convert_yuy2_x8r8g8b8(). */
+static inline WINED3D_SSE2_TARGET void convert_yuy2_rgb_sse2(__m128i yuyv, __m128i *r, __m128i *g, __m128i *b)
+{
+    const __m128i coeff_r = _mm_setr_epi16(298, 409, 298, 409, 298, 409, 298, 409);
+    const __m128i coeff_gu = _mm_setr_epi16(298, -100, 298, -100, 298, -100, 298, -100);
+    const __m128i coeff_gv = _mm_setr_epi16(0, -208, 0, -208, 0, -208, 0, -208);
+    const __m128i coeff_b = _mm_setr_epi16(298, 516, 298, 516, 298, 516, 298, 516);
+    const __m128i bias_r = _mm_set1_epi32(128 - 298 * 16 - 409 * 128);
+    const __m128i bias_g = _mm_set1_epi32(128 - 298 * 16 + 100 * 128 + 208 * 128);
+    const __m128i bias_b = _mm_set1_epi32(128 - 298 * 16 - 516 * 128);
+    __m128i yu, yv;
+
+    yu = _mm_shufflehi_epi16(_mm_shufflelo_epi16(yuyv, _MM_SHUFFLE(1, 2, 1, 0)), _MM_SHUFFLE(1, 2, 1, 0));
+    yv = _mm_shufflehi_epi16(_mm_shufflelo_epi16(yuyv, _MM_SHUFFLE(3, 2, 3, 0)), _MM_SHUFFLE(3, 2, 3, 0));
+    *r = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yv, coeff_r), bias_r), 8);
+    *g = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yu, coeff_gu),
+            _mm_madd_epi16(yv, coeff_gv)), bias_g), 8);
+    *b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yu, coeff_b), bias_b), 8);
+}
+
+/* Computes the RGB values of 8 YUY2 pixels as 16-bit values in [0, 255]. */
+static inline WINED3D_SSE2_TARGET void convert_yuy2_rgb8_sse2(const BYTE *src, __m128i *r, __m128i *g, __m128i *b)
+{
+    const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16(0xff);
+    __m128i pixels, r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+
+    pixels = _mm_loadu_si128((const __m128i *)src);
+    convert_yuy2_rgb_sse2(_mm_unpacklo_epi8(pixels, zero), &r_lo, &g_lo, &b_lo);
+    convert_yuy2_rgb_sse2(_mm_unpackhi_epi8(pixels, zero), &r_hi, &g_hi, &b_hi);
+    *r = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(r_lo, r_hi), zero), max);
+    *g = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(g_lo, g_hi), zero), max);
+    *b = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(b_lo, b_hi), zero), max);
+}
+
+/* Converts 8 pixels at a time, and returns the number of pixels converted. */
+static WINED3D_SSE2_TARGET unsigned int convert_yuy2_x8r8g8b8_sse2(const BYTE *src, DWORD *dst, unsigned int w)
+{
+    const __m128i alpha = _mm_set1_epi16(0xff00);
+    __m128i r, g, b, bg, ra;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= w; x += 8)
+    {
+        convert_yuy2_rgb8_sse2(&src[x * 2], &r, &g, &b);
+        bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        ra = _mm_or_si128(r, alpha);
+        _mm_storeu_si128((__m128i *)&dst[x], _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)&dst[x + 4], _mm_unpackhi_epi16(bg, ra));
+    }
+
+    return x;
+}
+
+/* Converts 8 pixels at a time, and returns the number of pixels converted. */
+static WINED3D_SSE2_TARGET unsigned int convert_yuy2_r5g6b5_sse2(const BYTE *src, WORD *dst, unsigned int w)
+{
+    __m128i r, g, b;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= w; x += 8)
+    {
+        convert_yuy2_rgb8_sse2(&src[x * 2], &r, &g, &b);
+        r = _mm_slli_epi16(_mm_srli_epi16(r, 3), 11);
+        g = _mm_slli_epi16(_mm_srli_epi16(g, 2), 5);
+        b = _mm_srli_epi16(b, 3);
+        _mm_storeu_si128((__m128i *)&dst[x], _mm_or_si128(_mm_or_si128(r, g), b));
+    }
+
+    return x;
+}
+#endif
+
 static void convert_yuy2_x8r8g8b8(const BYTE *src, BYTE *dst,
         DWORD pitch_in, DWORD pitch_out, unsigned int w, unsigned int h)
 {
     int c2, d, e, r2 = 0, g2 = 0, b2 = 0;
     unsigned int x, y;
+#ifdef WINED3D_HAVE_SSE2
+    BOOL sse2 = wined3d_use_sse2();
+#endif
 
     TRACE("Converting %ux%u pixels, pitches %u %u.\n", w, h, pitch_in, pitch_out);
 
@@ -203,7 +326,13 @@ static void convert_yuy2_x8r8g8b8(const BYTE *src, BYTE *dst,
     {
         const BYTE *src_line = src + y * pitch_in;
         DWORD *dst_line = (DWORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+
+#ifdef WINED3D_HAVE_SSE2
+        x = sse2 ? convert_yuy2_x8r8g8b8_sse2(src_line, dst_line, w) : 0;
+#else
+        x = 0;
+#endif
+        for (src_line += x * 2; x < w; ++x)
         {
             /* YUV to RGB conversion formulas from http://en.wikipedia.org/wiki/YUV:
              *     C = Y - 16; D = U - 128; E = V - 128;
@@ -238,6 +367,9 @@ static void convert_yuy2_r5g6b5(const BYTE *src, BYTE *dst,
 {
     unsigned int x, y;
     int c2, d, e, r2 = 0, g2 = 0, b2 = 0;
+#ifdef WINED3D_HAVE_SSE2
+    BOOL sse2 = wined3d_use_sse2();
+#endif
 
     TRACE("Converting %ux%u pixels, pitches %u %u\n", w, h, pitch_in, pitch_out);
 
@@ -245,7 +377,13 @@ static void convert_yuy2_r5g6b5(const BYTE *src, BYTE *dst,
     {
         const BYTE *src_line = src + y * pitch_in;
         WORD *dst_line = (WORD *)(dst + y * pitch_out);
-        for (x = 0; x < w; ++x)
+
+#ifdef WINED3D_HAVE_SSE2
+        x = sse2 ? convert_yuy2_r5g6b5_sse2(src_line, dst_line, w) : 0;
+#else
+        x = 0;
+#endif
+        for (src_line += x * 2; x < w; ++x)
         {
             /* YUV to RGB conversion formulas from http://en.wikipedia.org/wiki/YUV:
              *     C = Y - 16; D = U - 128; E = V - 128;
@@ -707,6 +845,366 @@ static HRESULT surface_cpu_blt_compressed(const BYTE *src_data, BYTE *dst_data,
     return E_NOTIMPL;
 }
 
+/* Rows of a blit without format conversion, for surface_cpu_blt(). */
+struct cpu_blt_desc
+{
+    const BYTE *src;
+    unsigned int src_row_pitch;
+    BYTE *dst;
+    LONG dst_x_inc, dst_y_inc;
+    unsigned int bpp, width, xinc, yinc;
+    BOOL simd;
+
+    DWORD keylow, keyhigh, keymask;
+    DWORD destkeylow, destkeyhigh, destkeymask;
+};
+
+typedef void (*cpu_blt_rows_func)(const struct cpu_blt_desc *desc, unsigned int start, unsigned int end);
+
+#define CPU_BLT_MAX_THREADS     8u
+#define CPU_BLT_MIN_BAND_ROWS   16u
+#define CPU_BLT_MIN_PARALLEL    (256u * 1024u)
+
+struct cpu_blt_job
+{
+    struct cpu_blt_desc desc;
+    cpu_blt_rows_func func;
+    unsigned int height, band_count;
+    LONG next_band, remaining, refcount;
+};
+
+static void cpu_blt_job_decref(struct cpu_blt_job *job)
+{
+    if (!InterlockedDecrement(&job->refcount))
+        heap_free(job);
+}
+
+/* Returns TRUE if there are no bands left to process. */
+static BOOL cpu_blt_job_process(struct cpu_blt_job *job)
+{
+    unsigned int band, start, end;
+    BOOL done = FALSE;
+
+    while ((band = InterlockedIncrement(&job->next_band) - 1) < job->band_count)
+    {
+        start = job->height * band / job->band_count;
+        end = job->height * (band + 1) / job->band_count;
+        job->func(&job->desc, start, end);
+        if (!InterlockedDecrement(&job->remaining))
+        {
+            RtlWakeAddressAll(&job->remaining);
+            done = TRUE;
+        }
+    }
+
+    return done;
+}
+
+static void CALLBACK cpu_blt_job_callback(TP_CALLBACK_INSTANCE *instance, void *ctx)
+{
+    struct cpu_blt_job *job = ctx;
+
+    cpu_blt_job_process(job);
+    cpu_blt_job_decref(job);
+}
+
+static unsigned int cpu_blt_get_thread_count(void)
+{
+    static unsigned int thread_count;
+    SYSTEM_INFO info;
+
+    if (!thread_count)
+    {
+        GetSystemInfo(&info);
+        thread_count = min(max(info.dwNumberOfProcessors, 1), CPU_BLT_MAX_THREADS);
+    }
+    return thread_count;
+}
+
+/* Split the rows of a blit into bands and process them on the thread pool as
+ * well as the calling thread. Only valid when the bands don't depend on each
+ * other, i.e. when the source and destination don't overlap.
+ *
+ * Only stretched and colour keyed blits use this. Compressed blits,
+ * format conversions and colour fills run on the calling thread. */
+static void cpu_blt_run(const struct cpu_blt_desc *desc, cpu_blt_rows_func func,
+        unsigned int height, BOOL parallel)
+{
+    unsigned int band_count, i;
+    struct cpu_blt_job *job;
+    LONG remaining;
+
+    band_count = min(cpu_blt_get_thread_count(), height / CPU_BLT_MIN_BAND_ROWS);
+    if (!parallel || band_count < 2 || (UINT64)desc->width * desc->bpp * height < CPU_BLT_MIN_PARALLEL
+            || !(job = heap_alloc(sizeof(*job))))
+    {
+        func(desc, 0, height);
+        return;
+    }
+
+    job->desc = *desc;
+    job->func = func;
+    job->height = height;
+    job->band_count = band_count;
+    job->next_band = 0;
+    job->remaining = band_count;
+    job->refcount = 1;
+
+    TRACE("Splitting %u rows into %u bands.\n", height, band_count);
+
+    for (i = 1; i < band_count; ++i)
+    {
+        InterlockedIncrement(&job->refcount);
+        if (!TrySubmitThreadpoolCallback(cpu_blt_job_callback, job, NULL))
+        {
+            cpu_blt_job_decref(job);
+            break;
+        }
+    }
+
+    if (!cpu_blt_job_process(job))
+    {
+        while ((remaining = *(volatile LONG *)&job->remaining))
+            RtlWaitOnAddress(&job->remaining, &remaining, sizeof(remaining), NULL);
+    }
+    cpu_blt_job_decref(job);
+}
+
+static void cpu_blt_stretch_rows(const struct cpu_blt_desc *desc, unsigned int start, unsigned int end)
+{
+    unsigned int row_byte_count = desc->width * desc->bpp;
+    unsigned int x, sx, y, sy, last_sy = ~0u;
+    BYTE *dbuf = desc->dst + (INT_PTR)start * desc->dst_y_inc;
+    const BYTE *sbuf;
+
+    for (y = start, sy = start * desc->yinc; y < end; ++y, sy += desc->yinc)
+    {
+        sbuf = desc->src + (sy >> 16) * desc->src_row_pitch;
+
+        if (desc->xinc == 1u << 16)
+        {
+            memcpy(dbuf, sbuf, row_byte_count);
+        }
+        else if ((sy >> 16) == (last_sy >> 16))
+        {
+            /* This source row is the same as last source row -
+             * Copy the already stretched row. */
+            memcpy(dbuf, dbuf - desc->dst_y_inc, row_byte_count);
+        }
+        else
+        {
+#define STRETCH_ROW(type) \
+do { \
+    const type *s = (const type *)sbuf; \
+    type *d = (type *)dbuf; \
+    for (x = sx = 0; x < desc->width; ++x, sx += desc->xinc) \
+        d[x] = s[sx >> 16]; \
+} while(0)
+
+            switch (desc->bpp)
+            {
+                case 1:
+                    STRETCH_ROW(BYTE);
+                    break;
+                case 2:
+                    STRETCH_ROW(WORD);
+                    break;
+                case 4:
+                    STRETCH_ROW(DWORD);
+                    break;
+                case 3:
+                {
+                    const BYTE *s;
+                    BYTE *d = dbuf;
+                    for (x = sx = 0; x < desc->width; x++, sx+= desc->xinc)
+                    {
+                        DWORD pixel;
+
+                        s = sbuf + 3 * (sx >> 16);
+                        pixel = s[0] | (s[1] << 8) | (s[2] << 16);
+                        d[0] = (pixel      ) & 0xff;
+                        d[1] = (pixel >>  8) & 0xff;
+                        d[2] = (pixel >> 16) & 0xff;
+                        d += 3;
+                    }
+                    break;
+                }
+            }
+#undef STRETCH_ROW
+        }
+        dbuf += desc->dst_y_inc;
+        last_sy = sy;
+    }
+}
+
+#ifdef WINED3D_HAVE_SSE2
+/* SSE2 only has signed comparisons, so the colors and the limits are biased
+ * before comparing. */
+struct cpu_blt_key_sse2
+{
+    __m128i bias, low, high;
+    BOOL empty;
+};
+
+static WINED3D_SSE2_TARGET void cpu_blt_key_sse2_init(struct cpu_blt_key_sse2 *key, DWORD low, DWORD high, unsigned int bpp)
+{
+    if (bpp == 2)
+    {
+        high = min(high, 0xffff);
+        key->bias = _mm_set1_epi16(0x8000);
+        key->low = _mm_set1_epi16(low ^ 0x8000);
+        key->high = _mm_set1_epi16(high ^ 0x8000);
+    }
+    else
+    {
+        key->bias = _mm_set1_epi32(0x80000000);
+        key->low = _mm_set1_epi32(low ^ 0x80000000);
+        key->high = _mm_set1_epi32(high ^ 0x80000000);
+    }
+    key->empty = low > high;
+}
+
+/* Returns all ones in the lanes of "color" that are not in the key range. */
+static inline WINED3D_SSE2_TARGET __m128i cpu_blt_key_sse2_not_in_range(const struct cpu_blt_key_sse2 *key,
+        __m128i color, unsigned int bpp)
+{
+    if (key->empty)
+        return _mm_set1_epi32(~0u);
+    color = _mm_xor_si128(color, key->bias);
+    if (bpp == 2)
+        return _mm_or_si128(_mm_cmplt_epi16(color, key->low), _mm_cmpgt_epi16(color, key->high));
+    return _mm_or_si128(_mm_cmplt_epi32(color, key->low), _mm_cmpgt_epi32(color, key->high));
+}
+
+/* Colour keyed copy of unstretched 16 or 32 bpp rows, 16 bytes at a time. */
+static WINED3D_SSE2_TARGET void cpu_blt_colour_key_rows_sse2(const struct cpu_blt_desc *desc, unsigned int start, unsigned int end)
+{
+    DWORD keylow = desc->keylow, keyhigh = desc->keyhigh, keymask = desc->keymask;
+    DWORD destkeylow = desc->destkeylow, destkeyhigh = desc->destkeyhigh, destkeymask = desc->destkeymask;
+    unsigned int bpp = desc->bpp, count = 16 / bpp, x, y;
+    __m128i src_mask, dst_mask, src, dst, copy;
+    struct cpu_blt_key_sse2 src_key, dst_key;
+    DWORD src_color, dst_color;
+    const BYTE *s;
+    BYTE *d;
+
+    cpu_blt_key_sse2_init(&src_key, keylow, keyhigh, bpp);
+    cpu_blt_key_sse2_init(&dst_key, destkeylow, destkeyhigh, bpp);
+    src_mask = bpp == 2 ? _mm_set1_epi16(keymask) : _mm_set1_epi32(keymask);
+    dst_mask = bpp == 2 ? _mm_set1_epi16(destkeymask) : _mm_set1_epi32(destkeymask);
+
+    for (y = start; y < end; ++y)
+    {
+        s = desc->src + ((y * desc->yinc) >> 16) * desc->src_row_pitch;
+        d = desc->dst + (INT_PTR)y * desc->dst_y_inc;
+
+        for (x = 0; x + count <= desc->width; x += count)
+        {
+            src = _mm_loadu_si128((const __m128i *)&s[x * bpp]);
+            dst = _mm_loadu_si128((const __m128i *)&d[x * bpp]);
+            copy = _mm_andnot_si128(cpu_blt_key_sse2_not_in_range(&dst_key, _mm_and_si128(dst, dst_mask), bpp),
+                    cpu_blt_key_sse2_not_in_range(&src_key, _mm_and_si128(src, src_mask), bpp));
+            _mm_storeu_si128((__m128i *)&d[x * bpp],
+                    _mm_or_si128(_mm_and_si128(copy, src), _mm_andnot_si128(copy, dst)));
+        }
+
+        for (; x < desc->width; ++x)
+        {
+            src_color = bpp == 2 ? ((const WORD *)s)[x] : ((const DWORD *)s)[x];
+            dst_color = bpp == 2 ? ((const WORD *)d)[x] : ((const DWORD *)d)[x];
+            if (((src_color & keymask) < keylow || (src_color & keymask) > keyhigh)
+                    && ((dst_color & destkeymask) >= destkeylow && (dst_color & destkeymask) <= destkeyhigh))
+            {
+                if (bpp == 2)
+                    ((WORD *)d)[x] = src_color;
+                else
+                    ((DWORD *)d)[x] = src_color;
+            }
+        }
+    }
+}
+#endif
+
+static void cpu_blt_colour_key_rows(const struct cpu_blt_desc *desc, unsigned int start, unsigned int end)
+{
+    DWORD keylow = desc->keylow, keyhigh = desc->keyhigh, keymask = desc->keymask;
+    DWORD destkeylow = desc->destkeylow, destkeyhigh = desc->destkeyhigh, destkeymask = desc->destkeymask;
+    LONG dstyinc = desc->dst_y_inc, dstxinc = desc->dst_x_inc;
+    unsigned int x, sx, y, sy;
+    const BYTE *sbuf;
+
+#ifdef WINED3D_HAVE_SSE2
+    if (desc->simd)
+    {
+        cpu_blt_colour_key_rows_sse2(desc, start, end);
+        return;
+    }
+#endif
+
+#define COPY_COLORKEY_FX(type) \
+do { \
+    const type *s; \
+    type *d = (type *)(desc->dst + (INT_PTR)start * dstyinc), *dx, tmp; \
+    for (y = start, sy = start * desc->yinc; y < end; ++y, sy += desc->yinc) \
+    { \
+        s = (const type *)(desc->src + (sy >> 16) * desc->src_row_pitch); \
+        dx = d; \
+        for (x = sx = 0; x < desc->width; ++x, sx += desc->xinc) \
+        { \
+            tmp = s[sx >> 16]; \
+            if (((tmp & keymask) < keylow || (tmp & keymask) > keyhigh) \
+                    && ((dx[0] & destkeymask) >= destkeylow && (dx[0] & destkeymask) <= destkeyhigh)) \
+            { \
+                dx[0] = tmp; \
+            } \
+            dx = (type *)(((BYTE *)dx) + dstxinc); \
+        } \
+        d = (type *)(((BYTE *)d) + dstyinc); \
+    } \
+} while(0)
+
+    switch (desc->bpp)
+    {
+        case 1:
+            COPY_COLORKEY_FX(BYTE);
+            break;
+        case 2:
+            COPY_COLORKEY_FX(WORD);
+            break;
+        case 4:
+            COPY_COLORKEY_FX(DWORD);
+            break;
+        case 3:
+        {
+            const BYTE *s;
+            BYTE *d = desc->dst + (INT_PTR)start * dstyinc, *dx;
+            for (y = start, sy = start * desc->yinc; y < end; ++y, sy += desc->yinc)
+            {
+                sbuf = desc->src + (sy >> 16) * desc->src_row_pitch;
+                dx = d;
+                for (x = sx = 0; x < desc->width; ++x, sx+= desc->xinc)
+                {
+                    DWORD pixel, dpixel = 0;
+                    s = sbuf + 3 * (sx>>16);
+                    pixel = s[0] | (s[1] << 8) | (s[2] << 16);
+                    dpixel = dx[0] | (dx[1] << 8 ) | (dx[2] << 16);
+                    if (((pixel & keymask) < keylow || (pixel & keymask) > keyhigh)
+                            && ((dpixel & keymask) >= destkeylow || (dpixel & keymask) <= keyhigh))
+                    {
+                        dx[0] = (pixel      ) & 0xff;
+                        dx[1] = (pixel >>  8) & 0xff;
+                        dx[2] = (pixel >> 16) & 0xff;
+                    }
+                    dx += dstxinc;
+                }
+                d += dstyinc;
+            }
+            break;
+        }
+    }
+#undef COPY_COLORKEY_FX
+}
+
 static HRESULT surface_cpu_blt(struct wined3d_texture *dst_texture, unsigned int dst_sub_resource_idx,
         const struct wined3d_box *dst_box, struct wined3d_texture *src_texture, unsigned int src_sub_resource_idx,
         const struct wined3d_box *src_box, DWORD flags, const struct wined3d_blt_fx *fx,
@@ -719,9 +1217,10 @@ static HRESULT surface_cpu_blt(struct wined3d_texture *dst_texture, unsigned int
     struct wined3d_bo_address src_data, dst_data;
     unsigned int src_fmt_flags, dst_fmt_flags;
     struct wined3d_map_desc dst_map, src_map;
-    unsigned int x, sx, xinc, y, sy, yinc;
+    unsigned int xinc, y, yinc;
     struct wined3d_context *context;
     struct wined3d_range dst_range;
+    struct cpu_blt_desc desc;
     unsigned int texture_level;
     HRESULT hr = WINED3D_OK;
     BOOL same_sub_resource;
@@ -849,6 +1348,7 @@ static HRESULT surface_cpu_blt(struct wined3d_texture *dst_texture, unsigned int
             goto release;
         }
 
+        /* Single-threaded, see cpu_blt_run(). */
         hr = surface_cpu_blt_compressed(sbase, dbuf,
                 src_map.row_pitch, dst_map.row_pitch, dst_width, dst_height,
                 src_format, flags, fx);
@@ -865,125 +1365,75 @@ static HRESULT surface_cpu_blt(struct wined3d_texture *dst_texture, unsigned int
     xinc = (src_width << 16) / dst_width;
     yinc = (src_height << 16) / dst_height;
 
+    if ((bpp < 1 || bpp > 4) && (flags || dst_width != src_width))
+    {
+        if (flags)
+            FIXME("%s color-keyed blit not implemented for bpp %u.\n",
+                    (flags & WINED3D_BLT_SRC_CKEY) ? "Source" : "Destination", bpp * 8);
+        else
+            FIXME("Stretched blit not implemented for bpp %u.\n", bpp * 8);
+        hr = WINED3DERR_NOTAVAILABLE;
+        goto error;
+    }
+
+    desc.src = sbase;
+    desc.src_row_pitch = src_map.row_pitch;
+    desc.dst = dbuf;
+    desc.dst_x_inc = bpp;
+    desc.dst_y_inc = dst_map.row_pitch;
+    desc.bpp = bpp;
+    desc.width = dst_width;
+    desc.xinc = xinc;
+    desc.yinc = yinc;
+    desc.simd = FALSE;
+
     if (!flags)
     {
         /* No effects, we can cheat here. */
-        if (dst_width == src_width)
+        if (dst_width == src_width && dst_height == src_height && same_sub_resource)
         {
-            if (dst_height == src_height)
-            {
-                /* No stretching in either direction. This needs to be as fast
-                 * as possible. */
-                sbuf = sbase;
+            /* No stretching in either direction. This needs to be as fast
+             * as possible. */
+            sbuf = sbase;
 
-                /* Check for overlapping surfaces. */
-                if (!same_sub_resource || dst_box->top < src_box->top
-                        || dst_box->right <= src_box->left || src_box->right <= dst_box->left)
-                {
-                    /* No overlap, or dst above src, so copy from top downwards. */
-                    for (y = 0; y < dst_height; ++y)
-                    {
-                        memcpy(dbuf, sbuf, row_byte_count);
-                        sbuf += src_map.row_pitch;
-                        dbuf += dst_map.row_pitch;
-                    }
-                }
-                else if (dst_box->top > src_box->top)
+            /* Check for overlapping surfaces. */
+            if (dst_box->top < src_box->top
+                    || dst_box->right <= src_box->left || src_box->right <= dst_box->left)
+            {
+                /* No overlap, or dst above src, so copy from top downwards. */
+                for (y = 0; y < dst_height; ++y)
                 {
-                    /* Copy from bottom upwards. */
-                    sbuf += src_map.row_pitch * dst_height;
-                    dbuf += dst_map.row_pitch * dst_height;
-                    for (y = 0; y < dst_height; ++y)
-                    {
-                        sbuf -= src_map.row_pitch;
-                        dbuf -= dst_map.row_pitch;
-                        memcpy(dbuf, sbuf, row_byte_count);
-                    }
+                    memcpy(dbuf, sbuf, row_byte_count);
+                    sbuf += src_map.row_pitch;
+                    dbuf += dst_map.row_pitch;
                 }
-                else
+            }
+            else if (dst_box->top > src_box->top)
+            {
+                /* Copy from bottom upwards. */
+                sbuf += src_map.row_pitch * dst_height;
+                dbuf += dst_map.row_pitch * dst_height;
+                for (y = 0; y < dst_height; ++y)
                 {
-                    /* Src and dst overlapping on the same line, use memmove. */
-                    for (y = 0; y < dst_height; ++y)
-                    {
-                        memmove(dbuf, sbuf, row_byte_count);
-                        sbuf += src_map.row_pitch;
-                        dbuf += dst_map.row_pitch;
-                    }
+                    sbuf -= src_map.row_pitch;
+                    dbuf -= dst_map.row_pitch;
+                    memcpy(dbuf, sbuf, row_byte_count);
                 }
             }
             else
             {
-                /* Stretching in y direction only. */
-                for (y = sy = 0; y < dst_height; ++y, sy += yinc)
+                /* Src and dst overlapping on the same line, use memmove. */
+                for (y = 0; y < dst_height; ++y)
                 {
-                    sbuf = sbase + (sy >> 16) * src_map.row_pitch;
-                    memcpy(dbuf, sbuf, row_byte_count);
+                    memmove(dbuf, sbuf, row_byte_count);
+                    sbuf += src_map.row_pitch;
                     dbuf += dst_map.row_pitch;
                 }
             }
         }
         else
         {
-            /* Stretching in X direction. */
-            unsigned int last_sy = ~0u;
-            for (y = sy = 0; y < dst_height; ++y, sy += yinc)
-            {
-                sbuf = sbase + (sy >> 16) * src_map.row_pitch;
-
-                if ((sy >> 16) == (last_sy >> 16))
-                {
-                    /* This source row is the same as last source row -
-                     * Copy the already stretched row. */
-                    memcpy(dbuf, dbuf - dst_map.row_pitch, row_byte_count);
-                }
-                else
-                {
-#define STRETCH_ROW(type) \
-do { \
-    const type *s = (const type *)sbuf; \
-    type *d = (type *)dbuf; \
-    for (x = sx = 0; x < dst_width; ++x, sx += xinc) \
-        d[x] = s[sx >> 16]; \
-} while(0)
-
-                    switch(bpp)
-                    {
-                        case 1:
-                            STRETCH_ROW(BYTE);
-                            break;
-                        case 2:
-                            STRETCH_ROW(WORD);
-                            break;
-                        case 4:
-                            STRETCH_ROW(DWORD);
-                            break;
-                        case 3:
-                        {
-                            const BYTE *s;
-                            BYTE *d = dbuf;
-                            for (x = sx = 0; x < dst_width; x++, sx+= xinc)
-                            {
-                                DWORD pixel;
-
-                                s = sbuf + 3 * (sx >> 16);
-                                pixel = s[0] | (s[1] << 8) | (s[2] << 16);
-                                d[0] = (pixel      ) & 0xff;
-                                d[1] = (pixel >>  8) & 0xff;
-                                d[2] = (pixel >> 16) & 0xff;
-                                d += 3;
-                            }
-                            break;
-                        }
-                        default:
-                            FIXME("Stretched blit not implemented for bpp %u.\n", bpp * 8);
-                            hr = WINED3DERR_NOTAVAILABLE;
-                            goto error;
-                    }
-#undef STRETCH_ROW
-                }
-                dbuf += dst_map.row_pitch;
-                last_sy = sy;
-            }
+            cpu_blt_run(&desc, cpu_blt_stretch_rows, dst_height, !same_sub_resource);
         }
     }
     else
@@ -1115,73 +1565,19 @@ do { \
             flags &= ~(WINED3D_BLT_FX);
         }
 
-#define COPY_COLORKEY_FX(type) \
-do { \
-    const type *s; \
-    type *d = (type *)dbuf, *dx, tmp; \
-    for (y = sy = 0; y < dst_height; ++y, sy += yinc) \
-    { \
-        s = (const type *)(sbase + (sy >> 16) * src_map.row_pitch); \
-        dx = d; \
-        for (x = sx = 0; x < dst_width; ++x, sx += xinc) \
-        { \
-            tmp = s[sx >> 16]; \
-            if (((tmp & keymask) < keylow || (tmp & keymask) > keyhigh) \
-                    && ((dx[0] & destkeymask) >= destkeylow && (dx[0] & destkeymask) <= destkeyhigh)) \
-            { \
-                dx[0] = tmp; \
-            } \
-            dx = (type *)(((BYTE *)dx) + dstxinc); \
-        } \
-        d = (type *)(((BYTE *)d) + dstyinc); \
-    } \
-} while(0)
-
-        switch (bpp)
-        {
-            case 1:
-                COPY_COLORKEY_FX(BYTE);
-                break;
-            case 2:
-                COPY_COLORKEY_FX(WORD);
-                break;
-            case 4:
-                COPY_COLORKEY_FX(DWORD);
-                break;
-            case 3:
-            {
-                const BYTE *s;
-                BYTE *d = dbuf, *dx;
-                for (y = sy = 0; y < dst_height; ++y, sy += yinc)
-                {
-                    sbuf = sbase + (sy >> 16) * src_map.row_pitch;
-                    dx = d;
-                    for (x = sx = 0; x < dst_width; ++x, sx+= xinc)
-                    {
-                        DWORD pixel, dpixel = 0;
-                        s = sbuf + 3 * (sx>>16);
-                        pixel = s[0] | (s[1] << 8) | (s[2] << 16);
-                        dpixel = dx[0] | (dx[1] << 8 ) | (dx[2] << 16);
-                        if (((pixel & keymask) < keylow || (pixel & keymask) > keyhigh)
-                                && ((dpixel & keymask) >= destkeylow || (dpixel & keymask) <= keyhigh))
-                        {
-                            dx[0] = (pixel      ) & 0xff;
-                            dx[1] = (pixel >>  8) & 0xff;
-                            dx[2] = (pixel >> 16) & 0xff;
-                        }
-                        dx += dstxinc;
-                    }
-                    d += dstyinc;
-                }
-                break;
-            }
-            default:
-                FIXME("%s color-keyed blit not implemented for bpp %u.\n",
-                      (flags & WINED3D_BLT_SRC_CKEY) ? "Source" : "Destination", bpp * 8);
-                hr = WINED3DERR_NOTAVAILABLE;
-                goto error;
-#undef COPY_COLORKEY_FX
-        }
+        desc.dst = dbuf;
+        desc.dst_x_inc = dstxinc;
+        desc.dst_y_inc = dstyinc;
+        desc.keylow = keylow;
+        desc.keyhigh = keyhigh;
+        desc.keymask = keymask;
+        desc.destkeylow = destkeylow;
+        desc.destkeyhigh = destkeyhigh;
+        desc.destkeymask = destkeymask;
+#ifdef WINED3D_HAVE_SSE2
+        desc.simd = wined3d_use_sse2() && !same_sub_resource && (bpp == 2 || bpp == 4) && xinc == 1u << 16 && dstxinc == bpp;
+#endif
+        cpu_blt_run(&desc, cpu_blt_colour_key_rows, dst_height, !same_sub_resource);
     }
 
 error:
@@ -1231,6 +1627,7 @@ release:
     return hr;
 }
 
+/* Single-threaded, see cpu_blt_run(). */
 static void surface_cpu_blt_colour_fill(struct wined3d_rendertarget_view *view,
         const struct wined3d_box *box, const struct wined3d_color *colour)
 {
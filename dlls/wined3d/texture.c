@@ -4690,7 +4690,9 @@ static void wined3d_texture_vk_upload_data(struct wined3d_context *context,
     struct wined3d_bo_vk *src_bo;
     struct wined3d_range range;
     VkBufferImageCopy region;
+    VkDeviceSize alignment;
     size_t src_offset;
+    uint32_t map_flags;
     void *map_ptr;
 
     TRACE("context %p, src_bo_addr %s, src_format %s, src_box %s, src_row_pitch %u, src_slice_pitch %u, "
@@ -4751,20 +4753,37 @@ static void wined3d_texture_vk_upload_data(struct wined3d_context *context,
 
     if (!src_bo_addr->buffer_object)
     {
-        if (!wined3d_context_vk_create_bo(context_vk, sub_resource->size,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &staging_bo))
+        /* vkCmdCopyBufferToImage() requires the buffer offset to be a
+         * multiple of both 4 and the texel block size. */
+        alignment = src_format->block_byte_count;
+        if (alignment & 3)
+            alignment *= 4;
+
+        if (wined3d_context_vk_get_staging_memory(context_vk, sub_resource->size, alignment, &staging_bo_addr))
         {
-            ERR("Failed to create staging bo.\n");
-            return;
+            src_bo = wined3d_bo_vk(staging_bo_addr.buffer_object);
+            map_flags = WINED3D_MAP_NOOVERWRITE | WINED3D_MAP_WRITE;
+        }
+        else
+        {
+            if (!wined3d_context_vk_create_bo(context_vk, sub_resource->size,
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &staging_bo))
+            {
+                ERR("Failed to create staging bo.\n");
+                return;
+            }
+
+            staging_bo_addr.buffer_object = &staging_bo.b;
+            staging_bo_addr.addr = NULL;
+            src_bo = &staging_bo;
+            map_flags = WINED3D_MAP_DISCARD | WINED3D_MAP_WRITE;
         }
 
-        staging_bo_addr.buffer_object = &staging_bo.b;
-        staging_bo_addr.addr = NULL;
-        if (!(map_ptr = wined3d_context_map_bo_address(context, &staging_bo_addr,
-                sub_resource->size, WINED3D_MAP_DISCARD | WINED3D_MAP_WRITE)))
+        if (!(map_ptr = wined3d_context_map_bo_address(context, &staging_bo_addr, sub_resource->size, map_flags)))
         {
             ERR("Failed to map staging bo.\n");
-            wined3d_context_vk_destroy_bo(context_vk, &staging_bo);
+            if (src_bo == &staging_bo)
+                wined3d_context_vk_destroy_bo(context_vk, &staging_bo);
             return;
         }
 
@@ -4772,13 +4791,11 @@ static void wined3d_texture_vk_upload_data(struct wined3d_context *context,
                 src_slice_pitch, map_ptr, dst_row_pitch, dst_slice_pitch, src_box->right - src_box->left,
                 src_box->bottom - src_box->top, src_box->back - src_box->front);
 
-        range.offset = 0;
+        range.offset = (uintptr_t)staging_bo_addr.addr;
         range.size = sub_resource->size;
         wined3d_context_unmap_bo_address(context, &staging_bo_addr, 1, &range);
 
-        src_bo = &staging_bo;
-
-        src_offset = 0;
+        src_offset = (uintptr_t)staging_bo_addr.addr;
         src_row_pitch = dst_row_pitch;
         src_slice_pitch = dst_slice_pitch;
     }
@@ -4850,7 +4867,7 @@ static void wined3d_texture_vk_upload_data(struct wined3d_context *context,
     {
         wined3d_context_vk_destroy_bo(context_vk, &staging_bo);
     }
-    else if (vk_barrier.srcAccessMask)
+    else if (src_bo_addr->buffer_object && vk_barrier.srcAccessMask)
     {
         VK_CALL(vkCmdPipelineBarrier(vk_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
                 bo_stage_flags, 0, 0, NULL, 0, NULL, 0, NULL));
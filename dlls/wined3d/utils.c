@@ -29,6 +29,9 @@
 #include <stdio.h>
 
 #include "wined3d_private.h"
+#ifdef WINED3D_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 
@@ -1169,6 +1172,79 @@ static BOOL color_in_range(const struct wined3d_color_key *color_key, DWORD colo
             && color <= color_key->color_space_high_value;
 }
 
+#ifdef WINED3D_HAVE_SSE2
+/* SSE2 only has signed comparisons, so the colors and the limits are biased
+ * by 0x8000 before comparing. */
+struct color_key_range_sse2
+{
+    __m128i bias, low, high;
+};
+
+/* Returns FALSE if no 16-bit color is in range. */
+static WINED3D_SSE2_TARGET BOOL color_key_range_sse2_init(struct color_key_range_sse2 *range,
+        const struct wined3d_color_key *color_key)
+{
+    DWORD high = min(color_key->color_space_high_value, 0xffff);
+
+    if (color_key->color_space_low_value > high)
+        return FALSE;
+    range->bias = _mm_set1_epi16(0x8000);
+    range->low = _mm_set1_epi16(color_key->color_space_low_value ^ 0x8000);
+    range->high = _mm_set1_epi16(high ^ 0x8000);
+    return TRUE;
+}
+
+/* Returns all ones in the lanes of "color" that are not in range. */
+static inline WINED3D_SSE2_TARGET __m128i color_not_in_range_sse2(const struct color_key_range_sse2 *range,
+        __m128i color)
+{
+    color = _mm_xor_si128(color, range->bias);
+    return _mm_or_si128(_mm_cmplt_epi16(color, range->low), _mm_cmpgt_epi16(color, range->high));
+}
+
+/* Converts 8 pixels at a time, and returns the number of pixels converted. */
+static WINED3D_SSE2_TARGET unsigned int convert_b5g6r5_unorm_b5g5r5a1_unorm_color_key_sse2(const WORD *src_row,
+        WORD *dst_row, unsigned int width, const struct wined3d_color_key *color_key)
+{
+    const __m128i mask_rg = _mm_set1_epi16(0xffc0), mask_b = _mm_set1_epi16(0x1f);
+    const __m128i alpha = _mm_set1_epi16(0x8000);
+    struct color_key_range_sse2 range;
+    BOOL in_range = color_key_range_sse2_init(&range, color_key);
+    __m128i src_color, a;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= width; x += 8)
+    {
+        src_color = _mm_loadu_si128((const __m128i *)&src_row[x]);
+        a = in_range ? _mm_and_si128(color_not_in_range_sse2(&range, src_color), alpha) : alpha;
+        _mm_storeu_si128((__m128i *)&dst_row[x], _mm_or_si128(a, _mm_or_si128(
+                _mm_srli_epi16(_mm_and_si128(src_color, mask_rg), 1), _mm_and_si128(src_color, mask_b))));
+    }
+
+    return x;
+}
+
+/* Converts 8 pixels at a time, and returns the number of pixels converted. */
+static WINED3D_SSE2_TARGET unsigned int convert_b5g5r5x1_unorm_b5g5r5a1_unorm_color_key_sse2(const WORD *src_row,
+        WORD *dst_row, unsigned int width, const struct wined3d_color_key *color_key)
+{
+    const __m128i mask_rgb = _mm_set1_epi16(0x7fff), alpha = _mm_set1_epi16(0x8000);
+    struct color_key_range_sse2 range;
+    BOOL in_range = color_key_range_sse2_init(&range, color_key);
+    __m128i src_color, a;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= width; x += 8)
+    {
+        src_color = _mm_loadu_si128((const __m128i *)&src_row[x]);
+        a = in_range ? _mm_and_si128(color_not_in_range_sse2(&range, src_color), alpha) : alpha;
+        _mm_storeu_si128((__m128i *)&dst_row[x], _mm_or_si128(_mm_and_si128(src_color, mask_rgb), a));
+    }
+
+    return x;
+}
+#endif
+
 static void convert_b5g6r5_unorm_b5g5r5a1_unorm_color_key(const BYTE *src, unsigned int src_pitch,
         BYTE *dst, unsigned int dst_pitch, unsigned int width, unsigned int height,
         const struct wined3d_color_key *color_key)
@@ -1176,12 +1252,20 @@ static void convert_b5g6r5_unorm_b5g5r5a1_unorm_color_key(const BYTE *src, unsig
     const WORD *src_row;
     unsigned int x, y;
     WORD *dst_row;
+#ifdef WINED3D_HAVE_SSE2
+    BOOL sse2 = wined3d_use_sse2();
+#endif
 
     for (y = 0; y < height; ++y)
     {
         src_row = (WORD *)&src[src_pitch * y];
         dst_row = (WORD *)&dst[dst_pitch * y];
-        for (x = 0; x < width; ++x)
+#ifdef WINED3D_HAVE_SSE2
+        x = sse2 ? convert_b5g6r5_unorm_b5g5r5a1_unorm_color_key_sse2(src_row, dst_row, width, color_key) : 0;
+#else
+        x = 0;
+#endif
+        for (; x < width; ++x)
         {
             WORD src_color = src_row[x];
             if (!color_in_range(color_key, src_color))
@@ -1199,12 +1283,20 @@ static void convert_b5g5r5x1_unorm_b5g5r5a1_unorm_color_key(const BYTE *src, uns
     const WORD *src_row;
     unsigned int x, y;
     WORD *dst_row;
+#ifdef WINED3D_HAVE_SSE2
+    BOOL sse2 = wined3d_use_sse2();
+#endif
 
     for (y = 0; y < height; ++y)
     {
         src_row = (WORD *)&src[src_pitch * y];
         dst_row = (WORD *)&dst[dst_pitch * y];
-        for (x = 0; x < width; ++x)
+#ifdef WINED3D_HAVE_SSE2
+        x = sse2 ? convert_b5g5r5x1_unorm_b5g5r5a1_unorm_color_key_sse2(src_row, dst_row, width, color_key) : 0;
+#else
+        x = 0;
+#endif
+        for (; x < width; ++x)
         {
             WORD src_color = src_row[x];
             if (color_in_range(color_key, src_color))
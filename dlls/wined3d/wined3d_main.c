@@ -124,6 +124,8 @@ struct wined3d_settings wined3d_settings =
     .max_sm_cs = UINT_MAX,
     .renderer = WINED3D_RENDERER_AUTO,
     .shader_backend = WINED3D_SHADER_BACKEND_AUTO,
+    .program_cache = TRUE,
+    .shader_compiler_threads = ~0u,
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -355,6 +357,14 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
         if (!get_config_key_dword(hkey, appkey, "SampleCount", &wined3d_settings.sample_count))
             ERR_(winediag)("Forcing sample count to %u. This may not be compatible with all applications.\n",
                     wined3d_settings.sample_count);
+        if (!get_config_key_dword(hkey, appkey, "ShaderCompilerThreads", &wined3d_settings.shader_compiler_threads))
+            TRACE("Limiting the number of shader compiler threads to %u.\n", wined3d_settings.shader_compiler_threads);
+        if (!get_config_key(hkey, appkey, "ProgramCache", buffer, size)
+                && !strcmp(buffer, "disabled"))
+        {
+            TRACE("Disabling the GLSL program binary cache.\n");
+            wined3d_settings.program_cache = FALSE;
+        }
         if (!get_config_key(hkey, appkey, "CheckFloatConstants", buffer, size)
                 && !strcmp(buffer, "enabled"))
         {
@@ -412,6 +422,7 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     unsigned int i;
 
     wined3d_spirv_shader_backend_cleanup();
+    wined3d_shader_parse_cache_cleanup();
 
     if (!TlsFree(wined3d_context_tls_idx))
     {
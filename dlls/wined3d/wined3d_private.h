@@ -70,6 +70,24 @@ static inline size_t align(size_t addr, size_t alignment)
 
 #define MAKEDWORD_VERSION(maj, min) (((maj & 0xffffu) << 16) | (min & 0xffffu))
 
+/* SSE2 is part of the x86-64 baseline. On i386, functions using SSE2
+ * intrinsics are compiled with the "sse2" target attribute, and only called
+ * when the CPU supports it. */
+#if defined(__x86_64__) || (defined(__i386__) && (defined(__clang__) \
+        || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define WINED3D_HAVE_SSE2
+#define WINED3D_SSE2_TARGET __attribute__((target("sse2")))
+
+static inline BOOL wined3d_use_sse2(void)
+{
+#ifdef __x86_64__
+    return TRUE;
+#else
+    return IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
+}
+#endif
+
 /* Driver quirks */
 #define WINED3D_QUIRK_ARB_VS_OFFSET_LIMIT       0x00000001
 #define WINED3D_QUIRK_GLSL_CLIP_VARYING         0x00000004
@@ -447,6 +465,18 @@ static inline unsigned int wined3d_popcount(unsigned int x)
 #endif
 }
 
+/* 64-bit FNV-1a, pass 0 as the initial hash. */
+static inline UINT64 wined3d_hash_data(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *ptr = data;
+
+    if (!hash)
+        hash = 0xcbf29ce484222325ull;
+    while (size--)
+        hash = (hash ^ *ptr++) * 0x100000001b3ull;
+    return hash;
+}
+
 #define ORM_BACKBUFFER  0
 #define ORM_FBO         1
 
@@ -497,6 +527,8 @@ struct wined3d_settings
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
     BOOL cb_access_map_w;
+    BOOL program_cache;
+    unsigned int shader_compiler_threads;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -1366,6 +1398,7 @@ extern const struct wined3d_shader_frontend sm4_shader_frontend DECLSPEC_HIDDEN;
 
 HRESULT shader_extract_from_dxbc(struct wined3d_shader *shader,
         unsigned int max_shader_version, enum wined3d_shader_byte_code_format *format) DECLSPEC_HIDDEN;
+void wined3d_shader_parse_cache_cleanup(void) DECLSPEC_HIDDEN;
 BOOL shader_get_stream_output_register_info(const struct wined3d_shader *shader,
         const struct wined3d_stream_output_element *so_element, unsigned int *register_idx,
         unsigned int *component_idx) DECLSPEC_HIDDEN;
@@ -2411,6 +2444,29 @@ struct wined3d_command_buffer_vk
     VkFence vk_fence;
 };
 
+/* A range of the staging ring that is in use until the command buffer with
+ * id "command_buffer_id" has completed. */
+struct wined3d_staging_segment_vk
+{
+    VkDeviceSize end;
+    uint64_t command_buffer_id;
+};
+
+struct wined3d_staging_ring_vk
+{
+    struct wined3d_bo_vk bo;
+    VkDeviceSize head, tail;
+
+    struct wined3d_staging_segment_vk *segments;
+    SIZE_T segments_size;
+    SIZE_T segment_count;
+
+    uint64_t upload_bytes;
+    unsigned int upload_count;
+    unsigned int stall_count;
+    unsigned int fallback_count;
+};
+
 enum wined3d_retired_object_type_vk
 {
     WINED3D_RETIRED_FREE_VK,
@@ -2633,6 +2689,7 @@ struct wined3d_context_vk
     struct list free_pipeline_statistics_query_pools;
     struct list free_stream_output_statistics_query_pools;
 
+    struct wined3d_staging_ring_vk staging_ring;
     struct wined3d_retired_objects_vk retired;
     struct wine_rb_tree render_passes;
     struct wine_rb_tree pipeline_layouts;
@@ -2683,6 +2740,8 @@ void wined3d_context_vk_destroy_vk_sampler(struct wined3d_context_vk *context_vk
         VkSampler vk_sampler, uint64_t command_buffer_id) DECLSPEC_HIDDEN;
 void wined3d_context_vk_end_current_render_pass(struct wined3d_context_vk *context_vk) DECLSPEC_HIDDEN;
 VkCommandBuffer wined3d_context_vk_get_command_buffer(struct wined3d_context_vk *context_vk) DECLSPEC_HIDDEN;
+BOOL wined3d_context_vk_get_staging_memory(struct wined3d_context_vk *context_vk, VkDeviceSize size,
+        VkDeviceSize alignment, struct wined3d_bo_address *address) DECLSPEC_HIDDEN;
 struct wined3d_pipeline_layout_vk *wined3d_context_vk_get_pipeline_layout(struct wined3d_context_vk *context_vk,
         VkDescriptorSetLayoutBinding *bindings, SIZE_T binding_count) DECLSPEC_HIDDEN;
 VkRenderPass wined3d_context_vk_get_render_pass(struct wined3d_context_vk *context_vk,
@@ -3280,6 +3339,7 @@ struct wined3d_gl_info
     DWORD reserved_glsl_constants, reserved_arb_constants;
     DWORD quirks;
     BOOL supported[WINED3D_GL_EXT_COUNT];
+    UINT64 driver_hash; /* Hash of the GL vendor, renderer and version strings. */
     GLint wrap_lookup[WINED3D_TADDRESS_MIRROR_ONCE - WINED3D_TADDRESS_WRAP + 1];
     float filling_convention_offset;
 
@@ -4846,10 +4906,25 @@ enum wined3d_push_constants
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x100000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_PRODUCER_SPIN_COUNT  4096u
 
 struct wined3d_cs_queue
 {
-    LONG head, tail;
+    /* Written by the producers. */
+    LONG head;
+    LONG waiters;
+
+    /* Statistics for the d3d_perf channel. */
+    unsigned int packet_count, stall_count;
+    ULONG max_occupancy;
+    ULONG64 occupancy_sum;
+    LONGLONG stall_time;
+
+    /* Written by the CS thread. "read" is how far the CS thread got, "tail"
+     * is only updated from it when the producers need to know. */
+    LONG tail DECLSPEC_ALIGN(64);
+    LONG read;
+
     BYTE data[WINED3D_CS_QUEUE_SIZE];
 };
 
@@ -4883,6 +4958,21 @@ struct wined3d_device_context
     struct wined3d_state *state;
 };
 
+enum wined3d_state_value_type
+{
+    WINED3D_STATE_VALUE_RENDER,
+    WINED3D_STATE_VALUE_TEXTURE,
+    WINED3D_STATE_VALUE_SAMPLER,
+};
+
+struct wined3d_state_value
+{
+    enum wined3d_state_value_type type;
+    unsigned int idx; /* Texture stage or sampler index. */
+    unsigned int state;
+    DWORD value;
+};
+
 struct wined3d_cs
 {
     struct wined3d_device_context c;
@@ -4902,6 +4992,7 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+    unsigned int draw_count;
 };
 
 static inline void wined3d_device_context_lock(struct wined3d_device_context *context)
@@ -5007,6 +5098,8 @@ void wined3d_device_context_emit_set_sampler_state(struct wined3d_device_context
         enum wined3d_sampler_state state, unsigned int value) DECLSPEC_HIDDEN;
 void wined3d_device_context_emit_set_scissor_rects(struct wined3d_device_context *context,
         unsigned int rect_count, const RECT *rects) DECLSPEC_HIDDEN;
+void wined3d_device_context_emit_set_states(struct wined3d_device_context *context,
+        unsigned int count, const struct wined3d_state_value *values) DECLSPEC_HIDDEN;
 void wined3d_device_context_emit_set_shader(struct wined3d_device_context *context, enum wined3d_shader_type type,
         struct wined3d_shader *shader) DECLSPEC_HIDDEN;
 void wined3d_device_context_emit_set_shader_resource_views(struct wined3d_device_context *context,
@@ -1557,6 +1557,8 @@ DWORD get_pixmap_image( Pixmap pixmap, int width, int height, const XVisualInfo
 }
 
 
+#define MAX_DIRTY_RECTS 16
+
 struct x11drv_window_surface
 {
     struct window_surface header;
@@ -1564,6 +1566,8 @@ struct x11drv_window_surface
     GC                    gc;
     XImage               *image;
     RECT                  bounds;
+    RECT                  dirty[MAX_DIRTY_RECTS];  /* dirty areas, all inside bounds */
+    int                   dirty_count;
     BOOL                  byteswap;
     BOOL                  is_argb;
     DWORD                 alpha_bits;
@@ -1789,6 +1793,99 @@ static int xshm_error_handler( Display *display, XErrorEvent *event, void *arg )
     return 1;  /* FIXME: should check event contents */
 }
 
+/* segments of destroyed surfaces are kept attached to the server for reuse, since windows
+ * get a new surface on every resize and attaching a segment requires a round trip */
+
+#define MAX_SHM_CACHE 4
+#define MAX_SHM_CACHE_SIZE (64 * 1024 * 1024)  /* total bytes kept in the cache */
+
+struct shm_segment
+{
+    XShmSegmentInfo info;
+    size_t          size;
+};
+
+static struct shm_segment shm_cache[MAX_SHM_CACHE];
+static int shm_cache_count;
+static size_t shm_cache_size;
+
+static CRITICAL_SECTION shm_cache_section;
+static CRITICAL_SECTION_DEBUG shm_cache_critsect_debug =
+{
+    0, 0, &shm_cache_section,
+    {&shm_cache_critsect_debug.ProcessLocksList, &shm_cache_critsect_debug.ProcessLocksList},
+     0, 0, {(DWORD_PTR)(__FILE__ ": shm_cache_section")}
+};
+static CRITICAL_SECTION shm_cache_section = {&shm_cache_critsect_debug, -1, 0, 0, 0, 0};
+
+/***********************************************************************
+ *           get_cached_shm_segment
+ *
+ * Find a cached segment large enough for the requested size, without wasting too much memory.
+ */
+static BOOL get_cached_shm_segment( size_t size, XShmSegmentInfo *shminfo )
+{
+    int i, best = -1;
+
+    EnterCriticalSection( &shm_cache_section );
+    for (i = 0; i < shm_cache_count; i++)
+    {
+        if (shm_cache[i].size < size || shm_cache[i].size / 2 > size) continue;
+        if (best == -1 || shm_cache[i].size < shm_cache[best].size) best = i;
+    }
+    if (best != -1)
+    {
+        *shminfo = shm_cache[best].info;
+        shm_cache_size -= shm_cache[best].size;
+        shm_cache[best] = shm_cache[--shm_cache_count];
+    }
+    LeaveCriticalSection( &shm_cache_section );
+
+    if (best == -1) return FALSE;
+    /* puts from the previous owner of the segment may still be pending,
+     * make sure the server is done reading it before it gets overwritten */
+    XSync( gdi_display, False );
+    TRACE( "reusing segment %d at %p for %u bytes\n", shminfo->shmid, shminfo->shmaddr, (UINT)size );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           release_shm_segment
+ */
+static void release_shm_segment( XShmSegmentInfo *shminfo, size_t size )
+{
+    struct shm_segment evicted[MAX_SHM_CACHE + 1];
+    int i, count = 0;
+
+    EnterCriticalSection( &shm_cache_section );
+    if (size > MAX_SHM_CACHE_SIZE / 2)  /* too large to be worth keeping */
+    {
+        evicted[count].info = *shminfo;
+        evicted[count++].size = size;
+    }
+    else
+    {
+        /* evict the oldest segments when the cache is full */
+        while (shm_cache_count == MAX_SHM_CACHE || shm_cache_size + size > MAX_SHM_CACHE_SIZE)
+        {
+            evicted[count++] = shm_cache[0];
+            shm_cache_size -= shm_cache[0].size;
+            memmove( shm_cache, shm_cache + 1, --shm_cache_count * sizeof(shm_cache[0]) );
+        }
+        shm_cache[shm_cache_count].info = *shminfo;
+        shm_cache[shm_cache_count].size = size;
+        shm_cache_count++;
+        shm_cache_size += size;
+    }
+    LeaveCriticalSection( &shm_cache_section );
+
+    for (i = 0; i < count; i++)
+    {
+        XShmDetach( gdi_display, &evicted[i].info );
+        shmdt( evicted[i].info.shmaddr );
+    }
+}
+
 static XImage *create_shm_image( const XVisualInfo *vis, int width, int height, XShmSegmentInfo *shminfo )
 {
     XImage *image;
@@ -1798,6 +1895,13 @@ static XImage *create_shm_image( const XVisualInfo *vis, int width, int height,
     if (!image) return NULL;
     if (image->bytes_per_line & 3) goto failed;  /* we need 32-bit alignment */
 
+    if (get_cached_shm_segment( image->bytes_per_line * height, shminfo ))
+    {
+        image->data = shminfo->shmaddr;
+        memset( image->data, 0, image->bytes_per_line * height );
+        return image;
+    }
+
     shminfo->shmid = shmget( IPC_PRIVATE, image->bytes_per_line * height, IPC_CREAT | 0700 );
     if (shminfo->shmid == -1) goto failed;
 
@@ -1868,6 +1972,60 @@ static RECT *CDECL x11drv_surface_get_bounds( struct window_surface *window_surf
     return &surface->bounds;
 }
 
+static inline LONGLONG get_rect_area( const RECT *rect )
+{
+    return (LONGLONG)(rect->right - rect->left) * (rect->bottom - rect->top);
+}
+
+/***********************************************************************
+ *           add_dirty_rect
+ *
+ * Add a rectangle to the list of dirty areas, merging it with the existing
+ * ones whenever that doesn't cause more pixels to be flushed, or with the
+ * closest one when the list is full.
+ */
+static void add_dirty_rect( struct x11drv_window_surface *surface, const RECT *rect )
+{
+    RECT rc = *rect, tmp;
+    LONGLONG cost, best_cost;
+    int i, best;
+
+    if (IsRectEmpty( &rc )) return;
+    add_bounds_rect( &surface->bounds, &rc );
+
+    for (;;)
+    {
+        best = -1;
+        best_cost = 0;
+        for (i = 0; i < surface->dirty_count; i++)
+        {
+            UnionRect( &tmp, &surface->dirty[i], &rc );
+            cost = get_rect_area( &tmp ) - get_rect_area( &surface->dirty[i] ) - get_rect_area( &rc );
+            if (best == -1 || cost < best_cost)
+            {
+                best = i;
+                best_cost = cost;
+            }
+        }
+        if (best == -1 || (best_cost > 0 && surface->dirty_count < MAX_DIRTY_RECTS))
+        {
+            surface->dirty[surface->dirty_count++] = rc;
+            return;
+        }
+        /* merge and try again, the union may now overlap other rectangles */
+        UnionRect( &rc, &rc, &surface->dirty[best] );
+        surface->dirty[best] = surface->dirty[--surface->dirty_count];
+    }
+}
+
+/***********************************************************************
+ *           x11drv_surface_add_dirty_rect
+ */
+static void CDECL x11drv_surface_add_dirty_rect( struct window_surface *window_surface, const RECT *rect )
+{
+    add_dirty_rect( get_x11_surface( window_surface ), rect );
+}
+
 /***********************************************************************
  *           x11drv_surface_set_region
  */
@@ -1900,69 +2058,127 @@ static void CDECL x11drv_surface_set_region( struct window_surface *window_surfa
 }
 
 /***********************************************************************
- *           x11drv_surface_flush
+ *           copy_surface_rows
+ *
+ * Update the image for a band of rows. Rows are copied across the whole
+ * width, only the alpha fixup is limited to the band's columns.
  */
-static void CDECL x11drv_surface_flush( struct window_surface *window_surface )
+static void copy_surface_rows( struct x11drv_window_surface *surface, const RECT *band )
 {
-    struct x11drv_window_surface *surface = get_x11_surface( window_surface );
     unsigned char *src = surface->bits;
     unsigned char *dst = (unsigned char *)surface->image->data;
-    struct bitblt_coords coords;
+    int width_bytes = surface->image->bytes_per_line;
 
-    window_surface->funcs->lock( window_surface );
-    coords.x = 0;
-    coords.y = 0;
-    coords.width  = surface->header.rect.right - surface->header.rect.left;
-    coords.height = surface->header.rect.bottom - surface->header.rect.top;
-    SetRect( &coords.visrect, 0, 0, coords.width, coords.height );
-    if (IntersectRect( &coords.visrect, &coords.visrect, &surface->bounds ))
+    if (src != dst)
     {
-        TRACE( "flushing %p %dx%d bounds %s bits %p\n",
-               surface, coords.width, coords.height,
-               wine_dbgstr_rect( &surface->bounds ), surface->bits );
+        int map[256], *mapping = get_window_surface_mapping( surface->image->bits_per_pixel, map );
 
-        if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
+        src += band->top * width_bytes;
+        dst += band->top * width_bytes;
+        copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
+                             band->bottom - band->top,
+                             surface->byteswap, mapping, ~0u, surface->alpha_bits );
+    }
+    else if (surface->alpha_bits)
+    {
+        int x, y, stride = width_bytes / sizeof(ULONG);
+        ULONG *ptr = (ULONG *)dst + band->top * stride;
 
-        if (src != dst)
+        for (y = band->top; y < band->bottom; y++, ptr += stride)
+            for (x = band->left; x < band->right; x++)
+                ptr[x] |= surface->alpha_bits;
+    }
+}
+
+/***********************************************************************
+ *           put_surface_rect
+ */
+static void put_surface_rect( struct x11drv_window_surface *surface, const RECT *rect )
+{
+#ifdef HAVE_LIBXXSHM
+    if (surface->shminfo.shmid != -1)
+        XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                      rect->left, rect->top,
+                      surface->header.rect.left + rect->left,
+                      surface->header.rect.top + rect->top,
+                      rect->right - rect->left, rect->bottom - rect->top, False );
+    else
+#endif
+    XPutImage( gdi_display, surface->window, surface->gc, surface->image,
+               rect->left, rect->top,
+               surface->header.rect.left + rect->left,
+               surface->header.rect.top + rect->top,
+               rect->right - rect->left, rect->bottom - rect->top );
+}
+
+/***********************************************************************
+ *           flush_dirty_rects
+ *
+ * Copy the rows covered by the dirty rectangles once, merging rectangles
+ * that share rows into bands, then put each rectangle to the window.
+ */
+static void flush_dirty_rects( struct x11drv_window_surface *surface, const RECT *visrect )
+{
+    RECT rects[MAX_DIRTY_RECTS], band, rect;
+    int i, j, count = 0;
+
+    /* sort by top edge, there are only a few of them */
+    for (i = 0; i < surface->dirty_count; i++)
+    {
+        if (!IntersectRect( &rect, visrect, &surface->dirty[i] )) continue;
+        for (j = count; j > 0 && rects[j - 1].top > rect.top; j--) rects[j] = rects[j - 1];
+        rects[j] = rect;
+        count++;
+    }
+    if (!count) return;
+
+    band = rects[0];
+    for (i = 1; i < count; i++)
+    {
+        if (rects[i].top <= band.bottom)
         {
-            int map[256], *mapping = get_window_surface_mapping( surface->image->bits_per_pixel, map );
-            int width_bytes = surface->image->bytes_per_line;
-
-            src += coords.visrect.top * width_bytes;
-            dst += coords.visrect.top * width_bytes;
-            copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
-                                 coords.visrect.bottom - coords.visrect.top,
-                                 surface->byteswap, mapping, ~0u, surface->alpha_bits );
+            band.left = min( band.left, rects[i].left );
+            band.right = max( band.right, rects[i].right );
+            band.bottom = max( band.bottom, rects[i].bottom );
+            continue;
         }
-        else if (surface->alpha_bits)
-        {
-            int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
-            ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
+        copy_surface_rows( surface, &band );
+        band = rects[i];
+    }
+    copy_surface_rows( surface, &band );
 
-            for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
-                for (x = coords.visrect.left; x < coords.visrect.right; x++)
-                    ptr[x] |= surface->alpha_bits;
-        }
+    for (i = 0; i < count; i++) put_surface_rect( surface, &rects[i] );
+}
 
-#ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                          coords.visrect.left, coords.visrect.top,
-                          surface->header.rect.left + coords.visrect.left,
-                          surface->header.rect.top + coords.visrect.top,
-                          coords.visrect.right - coords.visrect.left,
-                          coords.visrect.bottom - coords.visrect.top, False );
+/***********************************************************************
+ *           x11drv_surface_flush
+ */
+static void CDECL x11drv_surface_flush( struct window_surface *window_surface )
+{
+    struct x11drv_window_surface *surface = get_x11_surface( window_surface );
+    RECT rect, visrect;
+
+    window_surface->funcs->lock( window_surface );
+    SetRect( &visrect, 0, 0, surface->header.rect.right - surface->header.rect.left,
+             surface->header.rect.bottom - surface->header.rect.top );
+    if (IntersectRect( &rect, &visrect, &surface->bounds ))
+    {
+        TRACE( "flushing %p %dx%d bounds %s in %d rects bits %p\n",
+               surface, visrect.right, visrect.bottom, wine_dbgstr_rect( &surface->bounds ),
+               max( surface->dirty_count, 1 ), surface->bits );
+
+        if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
+
+        if (surface->dirty_count) flush_dirty_rects( surface, &visrect );
         else
-#endif
-        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                   coords.visrect.left, coords.visrect.top,
-                   surface->header.rect.left + coords.visrect.left,
-                   surface->header.rect.top + coords.visrect.top,
-                   coords.visrect.right - coords.visrect.left,
-                   coords.visrect.bottom - coords.visrect.top );
+        {
+            copy_surface_rows( surface, &rect );
+            put_surface_rect( surface, &rect );
+        }
         XFlush( gdi_display );
     }
     reset_bounds( &surface->bounds );
+    surface->dirty_count = 0;
     window_surface->funcs->unlock( window_surface );
 }
 
@@ -1981,8 +2197,9 @@ static void CDECL x11drv_surface_destroy( struct window_surface *window_surface
 #ifdef HAVE_LIBXXSHM
         if (surface->shminfo.shmid != -1)
         {
-            XShmDetach( gdi_display, &surface->shminfo );
-            shmdt( surface->shminfo.shmaddr );
+            /* puts from this surface may still be pending, the next user of the
+             * segment waits for them before writing to it */
+            release_shm_segment( &surface->shminfo, surface->image->bytes_per_line * surface->image->height );
         }
         else
 #endif
@@ -2004,7 +2221,8 @@ static const struct window_surface_funcs x11drv_surface_funcs =
     x11drv_surface_get_bounds,
     x11drv_surface_set_region,
     x11drv_surface_flush,
-    x11drv_surface_destroy
+    x11drv_surface_destroy,
+    x11drv_surface_add_dirty_rect
 };
 
 /***********************************************************************
@@ -2096,6 +2314,19 @@ void set_surface_color_key( struct window_surface *window_surface, COLORREF colo
     window_surface->funcs->unlock( window_surface );
 }
 
+/***********************************************************************
+ *           add_surface_dirty_rect
+ *
+ * Mark an area of the surface as needing a flush, the surface must be locked.
+ */
+void add_surface_dirty_rect( struct window_surface *window_surface, const RECT *rect )
+{
+    if (window_surface->funcs == &x11drv_surface_funcs)
+        add_dirty_rect( get_x11_surface( window_surface ), rect );
+    else
+        add_bounds_rect( window_surface->funcs->get_bounds( window_surface ), rect );
+}
+
 /***********************************************************************
  *           expose_surface
  */
@@ -2109,7 +2340,7 @@ HRGN expose_surface( struct window_surface *window_surface, const RECT *rect )
 
     window_surface->funcs->lock( window_surface );
     OffsetRect( &rc, -window_surface->rect.left, -window_surface->rect.top );
-    add_bounds_rect( &surface->bounds, &rc );
+    add_dirty_rect( surface, &rc );
     if (surface->region)
     {
         region = CreateRectRgnIndirect( rect );
@@ -3155,7 +3155,7 @@ static void update_window_surface(struct gl_drawable *gl, HWND hwnd)
         memcpy( dst_bits + (y + rect.top) * pitch + rect.left * stride,
                 src_bits + y * image->bytes_per_line, width * stride );
 
-    add_bounds_rect( surface->funcs->get_bounds( surface ), &rect );
+    add_surface_dirty_rect( surface, &rect );
 
 done:
     surface->funcs->unlock( surface );
@@ -180,6 +180,16 @@ struct font_enum_entry
     NEWTEXTMETRICEXW tm;
 };
 
+/* rectangle for NtGdiPolyPatBlt, a null brush uses the one selected in the DC */
+typedef struct
+{
+    INT    nXLeft;
+    INT    nYLeft;
+    INT    nWidth;
+    INT    nHeight;
+    HBRUSH hBrush;
+} POLYPATBLT;
+
 /* flag for NtGdiGetRandomRgn to respect LAYOUT_RTL */
 #define NTGDI_RGN_MIRROR_RTL   0x80000000
 
@@ -364,6 +374,7 @@ BOOL     WINAPI NtGdiPlgBlt( HDC hdc, const POINT *point, HDC hdc_src, INT x_src
                              INT width, INT height, HBITMAP mask, INT x_mask, INT y_mask,
                              DWORD bk_color );
 BOOL     WINAPI NtGdiPolyDraw(HDC hdc, const POINT *points, const BYTE *types, DWORD count );
+BOOL     WINAPI NtGdiPolyPatBlt( HDC hdc, DWORD rop, const POLYPATBLT *rects, DWORD count, DWORD mode );
 ULONG    WINAPI NtGdiPolyPolyDraw( HDC hdc, const POINT *points, const UINT *counts,
                                    DWORD count, UINT function );
 BOOL     WINAPI NtGdiPtInRegion( HRGN hrgn, INT x, INT y );
@@ -205,6 +205,9 @@ struct window_surface_funcs
     void  (CDECL *set_region)( struct window_surface *surface, HRGN region );
     void  (CDECL *flush)( struct window_surface *surface );
     void  (CDECL *destroy)( struct window_surface *surface );
+    /* optional, called with the surface locked for each area drawn through the window DC;
+     * the driver adds it to the bounds itself, which are otherwise left untouched */
+    void  (CDECL *add_dirty_rect)( struct window_surface *surface, const RECT *rect );
 };
 
 struct window_surface
@@ -0,0 +1,983 @@
+/*
+ * Direct3D CPU overhead micro-benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* d3dbench drives wined3d through d3d9 or d3d11 with synthetic workloads and
+ * reports the CPU time spent per draw. The time spent on the application
+ * thread is measured directly; the time spent by wined3d's command stream
+ * thread (and any driver threads) is measured as the CPU time consumed by all
+ * other threads of the process while the workload runs. Running under the
+ * "no3d" renderer, or OpenGL on llvmpipe, keeps GPU time out of the picture. */
+
+#define COBJMACROS
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <windef.h>
+#include <winbase.h>
+#include <winreg.h>
+#include <winuser.h>
+#include <tlhelp32.h>
+#include <d3d9.h>
+#include <d3d11.h>
+
+enum bench_api
+{
+    BENCH_API_D3D9,
+    BENCH_API_D3D11,
+};
+
+enum bench_workload
+{
+    BENCH_WORKLOAD_DRAW,
+    BENCH_WORKLOAD_MAP,
+    BENCH_WORKLOAD_CONSTANTS,
+    BENCH_WORKLOAD_COUNT,
+};
+
+static const WCHAR *workload_names[BENCH_WORKLOAD_COUNT] =
+{
+    L"draw",
+    L"map",
+    L"constants",
+};
+
+struct bench_options
+{
+    enum bench_api api;
+    unsigned int workloads;
+    unsigned int frame_count;
+    unsigned int draw_count;
+    unsigned int state_count;
+    const WCHAR *renderer;
+};
+
+/* The state of the AppDefaults key before -renderer was applied, so that it
+ * can be put back on exit. */
+struct renderer_override
+{
+    WCHAR app_key_name[MAX_PATH + 64];
+    WCHAR key_name[MAX_PATH + 64];
+    BOOL created_app_key;
+    BOOL created_key;
+    BYTE *value;
+    DWORD value_type;
+    DWORD value_size;
+};
+
+struct bench_sample
+{
+    LARGE_INTEGER qpc;
+    ULONGLONG app_cpu;
+    ULONGLONG other_cpu;
+};
+
+struct bench_result
+{
+    double wall_us;
+    double app_us;
+    double other_us;
+};
+
+struct vec3
+{
+    float x, y, z;
+};
+
+static const struct vec3 triangle[] =
+{
+    {-1.0f, -1.0f, 0.0f},
+    {-1.0f,  1.0f, 0.0f},
+    { 1.0f, -1.0f, 0.0f},
+};
+
+#define BENCH_RT_SIZE 256
+#define BENCH_MAP_VERTEX_COUNT (ARRAY_SIZE(triangle) * 1024)
+
+static ULONGLONG filetime_to_ull(const FILETIME *ft)
+{
+    return ((ULONGLONG)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+}
+
+static ULONGLONG thread_cpu_time(HANDLE thread)
+{
+    FILETIME creation, exit, kernel, user;
+
+    if (!GetThreadTimes(thread, &creation, &exit, &kernel, &user))
+        return 0;
+    return filetime_to_ull(&kernel) + filetime_to_ull(&user);
+}
+
+/* The command stream thread isn't exposed to applications, so account for the
+ * CPU time of every thread in the process except the calling one. Threads
+ * exiting between two samples are lost, which is fine for the long-lived
+ * threads we're interested in. */
+static ULONGLONG other_threads_cpu_time(void)
+{
+    DWORD pid = GetCurrentProcessId(), tid = GetCurrentThreadId();
+    THREADENTRY32 entry;
+    ULONGLONG total = 0;
+    HANDLE snapshot;
+    HANDLE thread;
+
+    if ((snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0)) == INVALID_HANDLE_VALUE)
+        return 0;
+
+    entry.dwSize = sizeof(entry);
+    if (Thread32First(snapshot, &entry))
+    {
+        do
+        {
+            if (entry.th32OwnerProcessID != pid || entry.th32ThreadID == tid)
+                continue;
+            if (!(thread = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, entry.th32ThreadID)))
+                continue;
+            total += thread_cpu_time(thread);
+            CloseHandle(thread);
+        } while (Thread32Next(snapshot, &entry));
+    }
+    CloseHandle(snapshot);
+
+    return total;
+}
+
+static void bench_take_sample(struct bench_sample *sample)
+{
+    QueryPerformanceCounter(&sample->qpc);
+    sample->app_cpu = thread_cpu_time(GetCurrentThread());
+    sample->other_cpu = other_threads_cpu_time();
+}
+
+/* The application thread is sampled once all the work has been submitted, the
+ * other threads once the device has been drained. Time spent by the
+ * application thread waiting for the device to become idle is not interesting
+ * and thus not accounted. */
+static void bench_compute_result(struct bench_result *result, const struct bench_sample *start,
+        const struct bench_sample *submitted, const struct bench_sample *end, unsigned int draw_count)
+{
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceFrequency(&frequency);
+    result->wall_us = (end->qpc.QuadPart - start->qpc.QuadPart) * 1000000.0 / frequency.QuadPart / draw_count;
+    result->app_us = (submitted->app_cpu - start->app_cpu) / 10.0 / draw_count;
+    result->other_us = (end->other_cpu - start->other_cpu) / 10.0 / draw_count;
+}
+
+static void bench_print_result(const struct bench_options *options,
+        enum bench_workload workload, const struct bench_result *result)
+{
+    printf("%-6ls %-10ls %8u %8u %14.3f %14.3f %14.3f\n",
+            options->api == BENCH_API_D3D9 ? L"d3d9" : L"d3d11", workload_names[workload],
+            options->draw_count, options->state_count, result->app_us, result->other_us, result->wall_us);
+}
+
+static HWND create_window(void)
+{
+    return CreateWindowA("static", "d3dbench", WS_OVERLAPPEDWINDOW,
+            0, 0, BENCH_RT_SIZE, BENCH_RT_SIZE, NULL, NULL, NULL, NULL);
+}
+
+struct d3d9_render_state
+{
+    D3DRENDERSTATETYPE state;
+    DWORD value[2];
+};
+
+static const struct d3d9_render_state d3d9_render_states[] =
+{
+    {D3DRS_ALPHABLENDENABLE,    {FALSE, TRUE}},
+    {D3DRS_CULLMODE,            {D3DCULL_NONE, D3DCULL_CW}},
+    {D3DRS_ZFUNC,               {D3DCMP_LESSEQUAL, D3DCMP_ALWAYS}},
+    {D3DRS_SRCBLEND,            {D3DBLEND_ONE, D3DBLEND_SRCALPHA}},
+    {D3DRS_DESTBLEND,           {D3DBLEND_ZERO, D3DBLEND_INVSRCALPHA}},
+    {D3DRS_COLORWRITEENABLE,    {0xf, 0x7}},
+    {D3DRS_ALPHATESTENABLE,     {FALSE, TRUE}},
+    {D3DRS_ALPHAREF,            {0x00, 0x80}},
+    {D3DRS_STENCILENABLE,       {FALSE, TRUE}},
+    {D3DRS_SCISSORTESTENABLE,   {FALSE, TRUE}},
+    {D3DRS_TEXTUREFACTOR,       {0xffffffff, 0xff00ff00}},
+    {D3DRS_DEPTHBIAS,           {0, 0x3f800000}},
+};
+
+struct d3d9_bench
+{
+    IDirect3DDevice9 *device;
+    IDirect3DVertexBuffer9 *vb, *dynamic_vb;
+    IDirect3DVertexShader9 *vs;
+    IDirect3DQuery9 *query;
+};
+
+static BOOL d3d9_bench_init(struct d3d9_bench *bench, HWND window)
+{
+    static const DWORD vs_code[] =
+    {
+        0xfffe0101,                                     /* vs_1_1           */
+        0x0000001f, 0x80000000, 0x900f0000,             /* dcl_position v0  */
+        0x00000001, 0xc00f0000, 0x90e40000,             /* mov oPos, v0     */
+        0x00000002, 0xd00f0000, 0xa0e40000, 0xa0e40001, /* add oD0, c0, c1  */
+        0x0000ffff,                                     /* end              */
+    };
+    D3DPRESENT_PARAMETERS present_parameters = {0};
+    IDirect3D9 *d3d;
+    void *data;
+    HRESULT hr;
+
+    memset(bench, 0, sizeof(*bench));
+
+    if (!(d3d = Direct3DCreate9(D3D_SDK_VERSION)))
+    {
+        fprintf(stderr, "Failed to create a D3D object.\n");
+        return FALSE;
+    }
+
+    present_parameters.Windowed = TRUE;
+    present_parameters.hDeviceWindow = window;
+    present_parameters.SwapEffect = D3DSWAPEFFECT_DISCARD;
+    present_parameters.BackBufferWidth = BENCH_RT_SIZE;
+    present_parameters.BackBufferHeight = BENCH_RT_SIZE;
+    present_parameters.BackBufferFormat = D3DFMT_A8R8G8B8;
+    present_parameters.EnableAutoDepthStencil = TRUE;
+    present_parameters.AutoDepthStencilFormat = D3DFMT_D24S8;
+    present_parameters.PresentationInterval = D3DPRESENT_INTERVAL_IMMEDIATE;
+    hr = IDirect3D9_CreateDevice(d3d, D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, window,
+            D3DCREATE_HARDWARE_VERTEXPROCESSING, &present_parameters, &bench->device);
+    IDirect3D9_Release(d3d);
+    if (FAILED(hr))
+    {
+        fprintf(stderr, "Failed to create a d3d9 device, hr %#lx.\n", hr);
+        return FALSE;
+    }
+
+    if (FAILED(hr = IDirect3DDevice9_CreateVertexBuffer(bench->device, sizeof(triangle),
+            D3DUSAGE_WRITEONLY, D3DFVF_XYZ, D3DPOOL_DEFAULT, &bench->vb, NULL)))
+        goto fail;
+    if (FAILED(hr = IDirect3DVertexBuffer9_Lock(bench->vb, 0, 0, &data, 0)))
+        goto fail;
+    memcpy(data, triangle, sizeof(triangle));
+    IDirect3DVertexBuffer9_Unlock(bench->vb);
+
+    if (FAILED(hr = IDirect3DDevice9_CreateVertexBuffer(bench->device, BENCH_MAP_VERTEX_COUNT * sizeof(*triangle),
+            D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, D3DFVF_XYZ, D3DPOOL_DEFAULT, &bench->dynamic_vb, NULL)))
+        goto fail;
+    if (FAILED(hr = IDirect3DDevice9_CreateVertexShader(bench->device, vs_code, &bench->vs)))
+        goto fail;
+    if (FAILED(hr = IDirect3DDevice9_CreateQuery(bench->device, D3DQUERYTYPE_EVENT, &bench->query)))
+        goto fail;
+
+    IDirect3DDevice9_SetFVF(bench->device, D3DFVF_XYZ);
+    IDirect3DDevice9_SetRenderState(bench->device, D3DRS_LIGHTING, FALSE);
+
+    return TRUE;
+
+fail:
+    fprintf(stderr, "Failed to create d3d9 resources, hr %#lx.\n", hr);
+    return FALSE;
+}
+
+static void d3d9_bench_cleanup(struct d3d9_bench *bench)
+{
+    if (bench->query)
+        IDirect3DQuery9_Release(bench->query);
+    if (bench->vs)
+        IDirect3DVertexShader9_Release(bench->vs);
+    if (bench->dynamic_vb)
+        IDirect3DVertexBuffer9_Release(bench->dynamic_vb);
+    if (bench->vb)
+        IDirect3DVertexBuffer9_Release(bench->vb);
+    if (bench->device)
+        IDirect3DDevice9_Release(bench->device);
+}
+
+static void d3d9_bench_wait_idle(struct d3d9_bench *bench)
+{
+    IDirect3DQuery9_Issue(bench->query, D3DISSUE_END);
+    while (IDirect3DQuery9_GetData(bench->query, NULL, 0, D3DGETDATA_FLUSH) == S_FALSE)
+        Sleep(0);
+}
+
+static void d3d9_bench_frame(struct d3d9_bench *bench, const struct bench_options *options,
+        enum bench_workload workload)
+{
+    IDirect3DDevice9 *device = bench->device;
+    unsigned int i, j, vertex_idx = 0;
+    float constants[8];
+    DWORD lock_flags;
+    void *data;
+
+    IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER | D3DCLEAR_STENCIL,
+            0xff000000, 1.0f, 0);
+    IDirect3DDevice9_BeginScene(device);
+
+    IDirect3DDevice9_SetVertexShader(device, workload == BENCH_WORKLOAD_CONSTANTS ? bench->vs : NULL);
+    IDirect3DDevice9_SetStreamSource(device, 0,
+            workload == BENCH_WORKLOAD_MAP ? bench->dynamic_vb : bench->vb, 0, sizeof(*triangle));
+
+    for (i = 0; i < options->draw_count; ++i)
+    {
+        for (j = 0; j < options->state_count; ++j)
+        {
+            const struct d3d9_render_state *s = &d3d9_render_states[j % ARRAY_SIZE(d3d9_render_states)];
+
+            IDirect3DDevice9_SetRenderState(device, s->state,
+                    s->value[(i + j / ARRAY_SIZE(d3d9_render_states)) & 1]);
+        }
+
+        switch (workload)
+        {
+            case BENCH_WORKLOAD_DRAW:
+                IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLELIST, 0, 1);
+                break;
+
+            case BENCH_WORKLOAD_MAP:
+                lock_flags = D3DLOCK_NOOVERWRITE;
+                if (!vertex_idx || vertex_idx + ARRAY_SIZE(triangle) > BENCH_MAP_VERTEX_COUNT)
+                {
+                    lock_flags = D3DLOCK_DISCARD;
+                    vertex_idx = 0;
+                }
+                if (SUCCEEDED(IDirect3DVertexBuffer9_Lock(bench->dynamic_vb, vertex_idx * sizeof(*triangle),
+                        sizeof(triangle), &data, lock_flags)))
+                {
+                    memcpy(data, triangle, sizeof(triangle));
+                    IDirect3DVertexBuffer9_Unlock(bench->dynamic_vb);
+                }
+                IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLELIST, vertex_idx, 1);
+                vertex_idx += ARRAY_SIZE(triangle);
+                break;
+
+            case BENCH_WORKLOAD_CONSTANTS:
+                for (j = 0; j < ARRAY_SIZE(constants); ++j)
+                    constants[j] = (float)((i + j) & 0xff) / 255.0f;
+                IDirect3DDevice9_SetVertexShaderConstantF(device, 0, constants, 2);
+                IDirect3DDevice9_DrawPrimitive(device, D3DPT_TRIANGLELIST, 0, 1);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    IDirect3DDevice9_EndScene(device);
+    IDirect3DDevice9_Present(device, NULL, NULL, NULL, NULL);
+}
+
+static BOOL d3d9_bench_run(const struct bench_options *options, HWND window)
+{
+    struct bench_sample start, submitted, end;
+    struct bench_result result;
+    struct d3d9_bench bench;
+    enum bench_workload w;
+    unsigned int i;
+
+    if (!d3d9_bench_init(&bench, window))
+    {
+        d3d9_bench_cleanup(&bench);
+        return FALSE;
+    }
+
+    for (w = 0; w < BENCH_WORKLOAD_COUNT; ++w)
+    {
+        if (!(options->workloads & (1u << w)))
+            continue;
+
+        /* Warm up, so that shader compilation and resource creation don't
+         * end up in the measurement. */
+        d3d9_bench_frame(&bench, options, w);
+        d3d9_bench_wait_idle(&bench);
+
+        bench_take_sample(&start);
+        for (i = 0; i < options->frame_count; ++i)
+            d3d9_bench_frame(&bench, options, w);
+        bench_take_sample(&submitted);
+        d3d9_bench_wait_idle(&bench);
+        bench_take_sample(&end);
+
+        bench_compute_result(&result, &start, &submitted, &end, options->frame_count * options->draw_count);
+        bench_print_result(options, w, &result);
+    }
+
+    d3d9_bench_cleanup(&bench);
+    return TRUE;
+}
+
+struct d3d11_bench
+{
+    ID3D11Device *device;
+    ID3D11DeviceContext *context;
+    ID3D11Texture2D *rt;
+    ID3D11RenderTargetView *rtv;
+    ID3D11Buffer *vb, *dynamic_vb, *cb;
+    ID3D11InputLayout *input_layout;
+    ID3D11VertexShader *vs;
+    ID3D11PixelShader *ps;
+    ID3D11RasterizerState *rasterizer_state[2];
+    ID3D11BlendState *blend_state[2];
+    ID3D11DepthStencilState *depth_stencil_state[2];
+    ID3D11Query *query;
+};
+
+static BOOL d3d11_bench_init(struct d3d11_bench *bench)
+{
+    static const DWORD vs_code[] =
+    {
+#if 0
+        float4 main(float4 position : POSITION) : SV_POSITION
+        {
+            return position;
+        }
+#endif
+        0x43425844, 0x4fb19b86, 0x955fa240, 0x1a630688, 0x24eb9db4, 0x00000001, 0x000001e0, 0x00000006,
+        0x00000038, 0x00000084, 0x000000d0, 0x00000134, 0x00000178, 0x000001ac, 0x53414e58, 0x00000044,
+        0x00000044, 0xfffe0200, 0x00000020, 0x00000024, 0x00240000, 0x00240000, 0x00240000, 0x00240000,
+        0x00240000, 0xfffe0200, 0x0200001f, 0x80000005, 0x900f0000, 0x02000001, 0xc00f0000, 0x80e40000,
+        0x0000ffff, 0x50414e58, 0x00000044, 0x00000044, 0xfffe0200, 0x00000020, 0x00000024, 0x00240000,
+        0x00240000, 0x00240000, 0x00240000, 0x00240000, 0xfffe0200, 0x0200001f, 0x80000005, 0x900f0000,
+        0x02000001, 0xc00f0000, 0x80e40000, 0x0000ffff, 0x396e6f41, 0x0000005c, 0x0000005c, 0xfffe0200,
+        0x00000034, 0x00000028, 0x00240000, 0x00240000, 0x00240000, 0x00240000, 0x00240001, 0x00000000,
+        0xfffe0200, 0x0200001f, 0x80000005, 0x900f0000, 0x04000004, 0xc0030000, 0x90ff0000, 0xa0e40000,
+        0x90e40000, 0x02000001, 0xc00c0000, 0x90e40000, 0x0000ffff, 0x52444853, 0x0000003c, 0x00010040,
+        0x0000000f, 0x0300005f, 0x001010f2, 0x00000000, 0x04000067, 0x001020f2, 0x00000000, 0x00000001,
+        0x05000036, 0x001020f2, 0x00000000, 0x00101e46, 0x00000000, 0x0100003e, 0x4e475349, 0x0000002c,
+        0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000003, 0x00000000, 0x00000f0f,
+        0x49534f50, 0x4e4f4954, 0xababab00, 0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000001, 0x00000003, 0x00000000, 0x0000000f, 0x505f5653, 0x5449534f, 0x004e4f49,
+    };
+    static const DWORD ps_code[] =
+    {
+#if 0
+        float4 color;
+
+        float4 main() : SV_TARGET
+        {
+            return color;
+        }
+#endif
+        0x43425844, 0xe7ffb369, 0x72bb84ee, 0x6f684dcd, 0xd367d788, 0x00000001, 0x00000158, 0x00000005,
+        0x00000034, 0x00000080, 0x000000cc, 0x00000114, 0x00000124, 0x53414e58, 0x00000044, 0x00000044,
+        0xffff0200, 0x00000014, 0x00000030, 0x00240001, 0x00300000, 0x00300000, 0x00240000, 0x00300000,
+        0x00000000, 0x00000001, 0x00000000, 0xffff0200, 0x02000001, 0x800f0800, 0xa0e40000, 0x0000ffff,
+        0x396e6f41, 0x00000044, 0x00000044, 0xffff0200, 0x00000014, 0x00000030, 0x00240001, 0x00300000,
+        0x00300000, 0x00240000, 0x00300000, 0x00000000, 0x00000001, 0x00000000, 0xffff0200, 0x02000001,
+        0x800f0800, 0xa0e40000, 0x0000ffff, 0x52444853, 0x00000040, 0x00000040, 0x00000010, 0x04000059,
+        0x00208e46, 0x00000000, 0x00000001, 0x03000065, 0x001020f2, 0x00000000, 0x06000036, 0x001020f2,
+        0x00000000, 0x00208e46, 0x00000000, 0x00000000, 0x0100003e, 0x4e475349, 0x00000008, 0x00000000,
+        0x00000008, 0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000,
+        0x00000003, 0x00000000, 0x0000000f, 0x545f5653, 0x45475241, 0xabab0054,
+    };
+    static const D3D11_INPUT_ELEMENT_DESC layout_desc[] =
+    {
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    };
+    D3D11_DEPTH_STENCIL_DESC depth_stencil_desc = {0};
+    D3D11_RASTERIZER_DESC rasterizer_desc = {0};
+    D3D11_SUBRESOURCE_DATA resource_data;
+    D3D11_TEXTURE2D_DESC texture_desc;
+    D3D11_BLEND_DESC blend_desc = {0};
+    D3D11_QUERY_DESC query_desc;
+    D3D11_BUFFER_DESC buffer_desc;
+    D3D11_VIEWPORT viewport;
+    unsigned int i;
+    HRESULT hr;
+
+    memset(bench, 0, sizeof(*bench));
+
+    if (FAILED(hr = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, 0, NULL, 0,
+            D3D11_SDK_VERSION, &bench->device, NULL, &bench->context)))
+    {
+        fprintf(stderr, "Failed to create a d3d11 device, hr %#lx.\n", hr);
+        return FALSE;
+    }
+
+    texture_desc.Width = BENCH_RT_SIZE;
+    texture_desc.Height = BENCH_RT_SIZE;
+    texture_desc.MipLevels = 1;
+    texture_desc.ArraySize = 1;
+    texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    texture_desc.SampleDesc.Count = 1;
+    texture_desc.SampleDesc.Quality = 0;
+    texture_desc.Usage = D3D11_USAGE_DEFAULT;
+    texture_desc.BindFlags = D3D11_BIND_RENDER_TARGET;
+    texture_desc.CPUAccessFlags = 0;
+    texture_desc.MiscFlags = 0;
+    if (FAILED(hr = ID3D11Device_CreateTexture2D(bench->device, &texture_desc, NULL, &bench->rt)))
+        goto fail;
+    if (FAILED(hr = ID3D11Device_CreateRenderTargetView(bench->device,
+            (ID3D11Resource *)bench->rt, NULL, &bench->rtv)))
+        goto fail;
+
+    buffer_desc.ByteWidth = sizeof(triangle);
+    buffer_desc.Usage = D3D11_USAGE_DEFAULT;
+    buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    buffer_desc.CPUAccessFlags = 0;
+    buffer_desc.MiscFlags = 0;
+    buffer_desc.StructureByteStride = 0;
+    resource_data.pSysMem = triangle;
+    resource_data.SysMemPitch = 0;
+    resource_data.SysMemSlicePitch = 0;
+    if (FAILED(hr = ID3D11Device_CreateBuffer(bench->device, &buffer_desc, &resource_data, &bench->vb)))
+        goto fail;
+
+    buffer_desc.ByteWidth = BENCH_MAP_VERTEX_COUNT * sizeof(*triangle);
+    buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+    buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    if (FAILED(hr = ID3D11Device_CreateBuffer(bench->device, &buffer_desc, NULL, &bench->dynamic_vb)))
+        goto fail;
+
+    buffer_desc.ByteWidth = 4 * sizeof(float);
+    buffer_desc.Usage = D3D11_USAGE_DEFAULT;
+    buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    buffer_desc.CPUAccessFlags = 0;
+    if (FAILED(hr = ID3D11Device_CreateBuffer(bench->device, &buffer_desc, NULL, &bench->cb)))
+        goto fail;
+
+    if (FAILED(hr = ID3D11Device_CreateInputLayout(bench->device, layout_desc, ARRAY_SIZE(layout_desc),
+            vs_code, sizeof(vs_code), &bench->input_layout)))
+        goto fail;
+    if (FAILED(hr = ID3D11Device_CreateVertexShader(bench->device, vs_code, sizeof(vs_code), NULL, &bench->vs)))
+        goto fail;
+    if (FAILED(hr = ID3D11Device_CreatePixelShader(bench->device, ps_code, sizeof(ps_code), NULL, &bench->ps)))
+        goto fail;
+
+    for (i = 0; i < 2; ++i)
+    {
+        rasterizer_desc.FillMode = D3D11_FILL_SOLID;
+        rasterizer_desc.CullMode = i ? D3D11_CULL_BACK : D3D11_CULL_NONE;
+        rasterizer_desc.DepthClipEnable = TRUE;
+        rasterizer_desc.ScissorEnable = i;
+        if (FAILED(hr = ID3D11Device_CreateRasterizerState(bench->device,
+                &rasterizer_desc, &bench->rasterizer_state[i])))
+            goto fail;
+
+        blend_desc.RenderTarget[0].BlendEnable = i;
+        blend_desc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+        blend_desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+        blend_desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+        blend_desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+        blend_desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+        blend_desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+        blend_desc.RenderTarget[0].RenderTargetWriteMask = i ? D3D11_COLOR_WRITE_ENABLE_RED
+                | D3D11_COLOR_WRITE_ENABLE_GREEN | D3D11_COLOR_WRITE_ENABLE_BLUE : D3D11_COLOR_WRITE_ENABLE_ALL;
+        if (FAILED(hr = ID3D11Device_CreateBlendState(bench->device, &blend_desc, &bench->blend_state[i])))
+            goto fail;
+
+        depth_stencil_desc.DepthEnable = i;
+        depth_stencil_desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+        depth_stencil_desc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+        depth_stencil_desc.StencilEnable = FALSE;
+        if (FAILED(hr = ID3D11Device_CreateDepthStencilState(bench->device,
+                &depth_stencil_desc, &bench->depth_stencil_state[i])))
+            goto fail;
+    }
+
+    query_desc.Query = D3D11_QUERY_EVENT;
+    query_desc.MiscFlags = 0;
+    if (FAILED(hr = ID3D11Device_CreateQuery(bench->device, &query_desc, &bench->query)))
+        goto fail;
+
+    viewport.TopLeftX = 0.0f;
+    viewport.TopLeftY = 0.0f;
+    viewport.Width = BENCH_RT_SIZE;
+    viewport.Height = BENCH_RT_SIZE;
+    viewport.MinDepth = 0.0f;
+    viewport.MaxDepth = 1.0f;
+    ID3D11DeviceContext_RSSetViewports(bench->context, 1, &viewport);
+    ID3D11DeviceContext_OMSetRenderTargets(bench->context, 1, &bench->rtv, NULL);
+    ID3D11DeviceContext_IASetInputLayout(bench->context, bench->input_layout);
+    ID3D11DeviceContext_IASetPrimitiveTopology(bench->context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D11DeviceContext_VSSetShader(bench->context, bench->vs, NULL, 0);
+    ID3D11DeviceContext_PSSetShader(bench->context, bench->ps, NULL, 0);
+    ID3D11DeviceContext_PSSetConstantBuffers(bench->context, 0, 1, &bench->cb);
+
+    return TRUE;
+
+fail:
+    fprintf(stderr, "Failed to create d3d11 resources, hr %#lx.\n", hr);
+    return FALSE;
+}
+
+static void d3d11_bench_cleanup(struct d3d11_bench *bench)
+{
+    unsigned int i;
+
+    if (bench->context)
+        ID3D11DeviceContext_ClearState(bench->context);
+
+    if (bench->query)
+        ID3D11Query_Release(bench->query);
+    for (i = 0; i < 2; ++i)
+    {
+        if (bench->depth_stencil_state[i])
+            ID3D11DepthStencilState_Release(bench->depth_stencil_state[i]);
+        if (bench->blend_state[i])
+            ID3D11BlendState_Release(bench->blend_state[i]);
+        if (bench->rasterizer_state[i])
+            ID3D11RasterizerState_Release(bench->rasterizer_state[i]);
+    }
+    if (bench->ps)
+        ID3D11PixelShader_Release(bench->ps);
+    if (bench->vs)
+        ID3D11VertexShader_Release(bench->vs);
+    if (bench->input_layout)
+        ID3D11InputLayout_Release(bench->input_layout);
+    if (bench->cb)
+        ID3D11Buffer_Release(bench->cb);
+    if (bench->dynamic_vb)
+        ID3D11Buffer_Release(bench->dynamic_vb);
+    if (bench->vb)
+        ID3D11Buffer_Release(bench->vb);
+    if (bench->rtv)
+        ID3D11RenderTargetView_Release(bench->rtv);
+    if (bench->rt)
+        ID3D11Texture2D_Release(bench->rt);
+    if (bench->context)
+        ID3D11DeviceContext_Release(bench->context);
+    if (bench->device)
+        ID3D11Device_Release(bench->device);
+}
+
+static void d3d11_bench_wait_idle(struct d3d11_bench *bench)
+{
+    ID3D11DeviceContext_End(bench->context, (ID3D11Asynchronous *)bench->query);
+    while (ID3D11DeviceContext_GetData(bench->context, (ID3D11Asynchronous *)bench->query, NULL, 0, 0) == S_FALSE)
+        Sleep(0);
+}
+
+static void d3d11_bench_frame(struct d3d11_bench *bench, const struct bench_options *options,
+        enum bench_workload workload)
+{
+    static const float clear_colour[] = {0.0f, 0.0f, 0.0f, 1.0f};
+    ID3D11DeviceContext *context = bench->context;
+    unsigned int i, j, vertex_idx = 0;
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    unsigned int stride, offset;
+    D3D11_MAP map_type;
+    float colour[4];
+
+    ID3D11DeviceContext_ClearRenderTargetView(context, bench->rtv, clear_colour);
+
+    stride = sizeof(*triangle);
+    offset = 0;
+    ID3D11DeviceContext_IASetVertexBuffers(context, 0, 1,
+            workload == BENCH_WORKLOAD_MAP ? &bench->dynamic_vb : &bench->vb, &stride, &offset);
+
+    for (i = 0; i < options->draw_count; ++i)
+    {
+        for (j = 0; j < options->state_count; ++j)
+        {
+            unsigned int idx = (i + j / 3) & 1;
+
+            switch (j % 3)
+            {
+                case 0:
+                    ID3D11DeviceContext_RSSetState(context, bench->rasterizer_state[idx]);
+                    break;
+                case 1:
+                    ID3D11DeviceContext_OMSetBlendState(context, bench->blend_state[idx], NULL, ~0u);
+                    break;
+                case 2:
+                    ID3D11DeviceContext_OMSetDepthStencilState(context, bench->depth_stencil_state[idx], 0);
+                    break;
+            }
+        }
+
+        switch (workload)
+        {
+            case BENCH_WORKLOAD_DRAW:
+                ID3D11DeviceContext_Draw(context, ARRAY_SIZE(triangle), 0);
+                break;
+
+            case BENCH_WORKLOAD_MAP:
+                map_type = D3D11_MAP_WRITE_NO_OVERWRITE;
+                if (!vertex_idx || vertex_idx + ARRAY_SIZE(triangle) > BENCH_MAP_VERTEX_COUNT)
+                {
+                    map_type = D3D11_MAP_WRITE_DISCARD;
+                    vertex_idx = 0;
+                }
+                if (SUCCEEDED(ID3D11DeviceContext_Map(context, (ID3D11Resource *)bench->dynamic_vb,
+                        0, map_type, 0, &map_desc)))
+                {
+                    memcpy((struct vec3 *)map_desc.pData + vertex_idx, triangle, sizeof(triangle));
+                    ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)bench->dynamic_vb, 0);
+                }
+                ID3D11DeviceContext_Draw(context, ARRAY_SIZE(triangle), vertex_idx);
+                vertex_idx += ARRAY_SIZE(triangle);
+                break;
+
+            case BENCH_WORKLOAD_CONSTANTS:
+                for (j = 0; j < ARRAY_SIZE(colour); ++j)
+                    colour[j] = (float)((i + j) & 0xff) / 255.0f;
+                ID3D11DeviceContext_UpdateSubresource(context, (ID3D11Resource *)bench->cb,
+                        0, NULL, colour, 0, 0);
+                ID3D11DeviceContext_Draw(context, ARRAY_SIZE(triangle), 0);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    ID3D11DeviceContext_Flush(context);
+}
+
+static BOOL d3d11_bench_run(const struct bench_options *options)
+{
+    struct bench_sample start, submitted, end;
+    struct bench_result result;
+    struct d3d11_bench bench;
+    enum bench_workload w;
+    unsigned int i;
+
+    if (!d3d11_bench_init(&bench))
+    {
+        d3d11_bench_cleanup(&bench);
+        return FALSE;
+    }
+
+    for (w = 0; w < BENCH_WORKLOAD_COUNT; ++w)
+    {
+        if (!(options->workloads & (1u << w)))
+            continue;
+
+        d3d11_bench_frame(&bench, options, w);
+        d3d11_bench_wait_idle(&bench);
+
+        bench_take_sample(&start);
+        for (i = 0; i < options->frame_count; ++i)
+            d3d11_bench_frame(&bench, options, w);
+        bench_take_sample(&submitted);
+        d3d11_bench_wait_idle(&bench);
+        bench_take_sample(&end);
+
+        bench_compute_result(&result, &start, &submitted, &end, options->frame_count * options->draw_count);
+        bench_print_result(options, w, &result);
+    }
+
+    d3d11_bench_cleanup(&bench);
+    return TRUE;
+}
+
+/* wined3d reads its configuration when it's loaded, which is why d3d9 and
+ * d3d11 are delay-imported. Keys created here are volatile, but an existing
+ * key stays persistent, so the previous state is saved and restored by
+ * restore_renderer(). */
+static BOOL set_renderer(const WCHAR *renderer, struct renderer_override *override)
+{
+    WCHAR path[MAX_PATH];
+    const WCHAR *filename;
+    DWORD disposition;
+    LSTATUS status;
+    HKEY key;
+
+    memset(override, 0, sizeof(*override));
+
+    GetModuleFileNameW(NULL, path, ARRAY_SIZE(path));
+    if ((filename = wcsrchr(path, '\\')))
+        ++filename;
+    else
+        filename = path;
+
+    swprintf(override->app_key_name, ARRAY_SIZE(override->app_key_name),
+            L"Software\\Wine\\AppDefaults\\%ls", filename);
+    swprintf(override->key_name, ARRAY_SIZE(override->key_name), L"%ls\\Direct3D", override->app_key_name);
+
+    if (!RegOpenKeyExW(HKEY_CURRENT_USER, override->app_key_name, 0, KEY_QUERY_VALUE, &key))
+        RegCloseKey(key);
+    else
+        override->created_app_key = TRUE;
+
+    if ((status = RegCreateKeyExW(HKEY_CURRENT_USER, override->key_name, 0, NULL, REG_OPTION_VOLATILE,
+            KEY_QUERY_VALUE | KEY_SET_VALUE, NULL, &key, &disposition)))
+    {
+        fprintf(stderr, "Failed to create key %ls, status %ld.\n", override->key_name, status);
+        return FALSE;
+    }
+    override->created_key = disposition == REG_CREATED_NEW_KEY;
+
+    if (!override->created_key && !RegQueryValueExW(key, L"renderer", NULL, NULL, NULL, &override->value_size))
+    {
+        if (!(override->value = malloc(override->value_size))
+                || RegQueryValueExW(key, L"renderer", NULL, &override->value_type,
+                override->value, &override->value_size))
+        {
+            fprintf(stderr, "Failed to save the previous renderer.\n");
+            free(override->value);
+            override->value = NULL;
+            RegCloseKey(key);
+            return FALSE;
+        }
+    }
+
+    status = RegSetValueExW(key, L"renderer", 0, REG_SZ, (const BYTE *)renderer,
+            (wcslen(renderer) + 1) * sizeof(WCHAR));
+    RegCloseKey(key);
+
+    return !status;
+}
+
+static void restore_renderer(struct renderer_override *override)
+{
+    LSTATUS status;
+    HKEY key;
+
+    if (override->created_key)
+    {
+        status = RegDeleteKeyW(HKEY_CURRENT_USER, override->key_name);
+        if (!status && override->created_app_key)
+            status = RegDeleteKeyW(HKEY_CURRENT_USER, override->app_key_name);
+    }
+    else if (!(status = RegOpenKeyExW(HKEY_CURRENT_USER, override->key_name, 0, KEY_SET_VALUE, &key)))
+    {
+        if (override->value)
+            status = RegSetValueExW(key, L"renderer", 0, override->value_type,
+                    override->value, override->value_size);
+        else
+            status = RegDeleteValueW(key, L"renderer");
+        RegCloseKey(key);
+    }
+    if (status)
+        fprintf(stderr, "Failed to restore key %ls, status %ld.\n", override->key_name, status);
+
+    free(override->value);
+}
+
+/* wined3d_cs_run() busy-waits on an empty queue, and keeps doing so while
+ * queries are pending. That time can't be told apart from command execution
+ * by sampling thread times. */
+static const char other_note[] =
+        "Note that \"other\" includes the time the command stream thread spends\n"
+        "spin-waiting for work; when the application thread is the bottleneck it\n"
+        "approaches \"wall\" regardless of the actual command execution cost.\n";
+
+static void usage(void)
+{
+    printf("Usage: d3dbench [options]\n"
+            "  -d3d9 | -d3d11        API to benchmark (default: d3d9)\n"
+            "  -workload <name>      draw, map, constants or all (default: all)\n"
+            "  -frames <count>       frames per workload (default: 100)\n"
+            "  -draws <count>        draws per frame (default: 1000)\n"
+            "  -states <count>       state changes per draw (default: 4)\n"
+            "  -renderer <name>      wined3d renderer, e.g. no3d, gl or vulkan\n"
+            "\n"
+            "Times are CPU microseconds per draw. \"app\" is the application thread,\n"
+            "\"other\" is every other thread, i.e. the wined3d command stream thread\n"
+            "and driver threads, and \"wall\" is elapsed time until the device is idle.\n"
+            "\n%s", other_note);
+}
+
+int __cdecl wmain(int argc, WCHAR *argv[])
+{
+    struct renderer_override override;
+    struct bench_options options;
+    BOOL ret = FALSE;
+    HWND window;
+    int i;
+
+    options.api = BENCH_API_D3D9;
+    options.workloads = (1u << BENCH_WORKLOAD_COUNT) - 1;
+    options.frame_count = 100;
+    options.draw_count = 1000;
+    options.state_count = 4;
+    options.renderer = NULL;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!wcsicmp(argv[i], L"-d3d9"))
+        {
+            options.api = BENCH_API_D3D9;
+        }
+        else if (!wcsicmp(argv[i], L"-d3d11"))
+        {
+            options.api = BENCH_API_D3D11;
+        }
+        else if (!wcsicmp(argv[i], L"-workload") && i + 1 < argc)
+        {
+            enum bench_workload w;
+
+            ++i;
+            if (!wcsicmp(argv[i], L"all"))
+            {
+                options.workloads = (1u << BENCH_WORKLOAD_COUNT) - 1;
+                continue;
+            }
+            for (w = 0; w < BENCH_WORKLOAD_COUNT; ++w)
+            {
+                if (!wcsicmp(argv[i], workload_names[w]))
+                    break;
+            }
+            if (w == BENCH_WORKLOAD_COUNT)
+            {
+                usage();
+                return 1;
+            }
+            options.workloads = 1u << w;
+        }
+        else if (!wcsicmp(argv[i], L"-frames") && i + 1 < argc)
+        {
+            options.frame_count = wcstoul(argv[++i], NULL, 10);
+        }
+        else if (!wcsicmp(argv[i], L"-draws") && i + 1 < argc)
+        {
+            options.draw_count = wcstoul(argv[++i], NULL, 10);
+        }
+        else if (!wcsicmp(argv[i], L"-states") && i + 1 < argc)
+        {
+            options.state_count = wcstoul(argv[++i], NULL, 10);
+        }
+        else if (!wcsicmp(argv[i], L"-renderer") && i + 1 < argc)
+        {
+            options.renderer = argv[++i];
+        }
+        else
+        {
+            usage();
+            return !!wcscmp(argv[i], L"-?") && !!wcscmp(argv[i], L"/?");
+        }
+    }
+
+    if (!options.frame_count || !options.draw_count)
+    {
+        usage();
+        return 1;
+    }
+
+    if (options.renderer && !set_renderer(options.renderer, &override))
+        return 1;
+
+    if ((window = create_window()))
+    {
+        printf("%-6s %-10s %8s %8s %14s %14s %14s\n", "api", "workload", "draws", "states",
+                "app us/draw", "other us/draw", "wall us/draw");
+
+        if (options.api == BENCH_API_D3D9)
+            ret = d3d9_bench_run(&options, window);
+        else
+            ret = d3d11_bench_run(&options);
+
+        printf("\n%s", other_note);
+
+        DestroyWindow(window);
+    }
+    else
+    {
+        fprintf(stderr, "Failed to create a window.\n");
+    }
+
+    if (options.renderer)
+        restore_renderer(&override);
+
+    return ret ? 0 : 1;
+}
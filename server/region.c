@@ -758,6 +758,56 @@ struct region *copy_region( struct region *dst, const struct region *src )
     return dst;
 }
 
+/* check if a rectangle contains all of a region */
+static inline int rect_contains_region( const rectangle_t *rect, const struct region *region )
+{
+    return (rect->left <= region->extents.left && rect->top <= region->extents.top &&
+            rect->right >= region->extents.right && rect->bottom >= region->extents.bottom);
+}
+
+/* subtract rectangle b from rectangle a into dst; the rectangles must overlap */
+static struct region *subtract_rect( struct region *dst, rectangle_t a, rectangle_t b )
+{
+    rectangle_t *rect;
+    int top = max( a.top, b.top ), bottom = min( a.bottom, b.bottom );
+
+    dst->num_rects = 0;
+    if (b.top > a.top)
+    {
+        if (!(rect = add_rect( dst ))) return NULL;
+        rect->left   = a.left;
+        rect->top    = a.top;
+        rect->right  = a.right;
+        rect->bottom = b.top;
+    }
+    if (b.left > a.left)
+    {
+        if (!(rect = add_rect( dst ))) return NULL;
+        rect->left   = a.left;
+        rect->top    = top;
+        rect->right  = b.left;
+        rect->bottom = bottom;
+    }
+    if (b.right < a.right)
+    {
+        if (!(rect = add_rect( dst ))) return NULL;
+        rect->left   = b.right;
+        rect->top    = top;
+        rect->right  = a.right;
+        rect->bottom = bottom;
+    }
+    if (b.bottom < a.bottom)
+    {
+        if (!(rect = add_rect( dst ))) return NULL;
+        rect->left   = a.left;
+        rect->top    = b.bottom;
+        rect->right  = a.right;
+        rect->bottom = a.bottom;
+    }
+    set_region_extents( dst );
+    return dst;
+}
+
 /* compute the intersection of two regions into dst, which can be one of the source regions */
 struct region *intersect_region( struct region *dst, const struct region *src1,
                                  const struct region *src2 )
@@ -771,6 +821,8 @@ struct region *intersect_region( struct region *dst, const struct region *src1,
         dst->extents.bottom = 0;
         return dst;
     }
+    if (src2->num_rects == 1 && rect_contains_region( &src2->extents, src1 )) return copy_region( dst, src1 );
+    if (src1->num_rects == 1 && rect_contains_region( &src1->extents, src2 )) return copy_region( dst, src2 );
     if (!region_op( dst, src1, src2, intersect_overlapping, NULL, NULL )) return NULL;
     set_region_extents( dst );
     return dst;
@@ -783,6 +835,18 @@ struct region *subtract_region( struct region *dst, const struct region *src1,
     if (!src1->num_rects || !src2->num_rects || !EXTENTCHECK(&src1->extents, &src2->extents))
         return copy_region( dst, src1 );
 
+    if (src2->num_rects == 1)
+    {
+        if (rect_contains_region( &src2->extents, src1 ))
+        {
+            dst->num_rects = 0;
+            dst->extents = empty_rect;
+            return dst;
+        }
+        /* clipping a window rectangle against another one is the common case */
+        if (src1->num_rects == 1) return subtract_rect( dst, src1->extents, src2->extents );
+    }
+
     if (!region_op( dst, src1, src2, subtract_overlapping,
                     subtract_non_overlapping, NULL )) return NULL;
     set_region_extents( dst );
@@ -54,6 +54,14 @@ enum property_type
 };
 
 
+/* cached result of get_visible_region() */
+struct visible_region_cache
+{
+    struct region   *region;          /* visible region, NULL if not computed yet */
+    unsigned int     flags;           /* DCX_* flags it was computed with */
+    unsigned int     serial;          /* visible_region_serial at the time it was computed */
+};
+
 struct window
 {
     struct window   *parent;          /* parent window */
@@ -92,6 +100,7 @@ struct window
     int              prop_inuse;      /* number of in-use window properties */
     int              prop_alloc;      /* number of allocated window properties */
     struct property *properties;      /* window properties array */
+    struct visible_region_cache vis_cache[2]; /* cached visible regions, window and client */
     int              nb_extra_bytes;  /* number of extra bytes */
     char             extra_bytes[1];  /* extra bytes storage */
 };
@@ -187,9 +196,20 @@ static unsigned int get_monitor_dpi( struct window *win )
     return win->dpi ? win->dpi : USER_DEFAULT_SCREEN_DPI;
 }
 
+/* serial number of the window geometry, changed whenever a visible region may change */
+static unsigned int visible_region_serial = 1;
+
+/* invalidate the cached visible regions of all the windows */
+static inline void invalidate_visible_regions(void)
+{
+    if (!++visible_region_serial) visible_region_serial = 1;
+}
+
 /* link a window at the right place in the siblings list */
 static void link_window( struct window *win, struct window *previous )
 {
+    invalidate_visible_regions();
+
     if (previous == WINPTR_NOTOPMOST)
     {
         if (!(win->ex_style & WS_EX_TOPMOST) && win->is_linked) return;  /* nothing to do */
@@ -281,6 +301,7 @@ static int set_parent_window( struct window *win, struct window *parent )
         list_remove( &win->entry );  /* unlink it from the previous location */
         list_add_head( &win->parent->unlinked, &win->entry );
         win->is_linked = 0;
+        invalidate_visible_regions();
     }
     return 1;
 }
@@ -512,6 +533,7 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->prop_alloc     = 0;
     win->properties     = NULL;
     win->nb_extra_bytes = extra_bytes;
+    memset( win->vis_cache, 0, sizeof(win->vis_cache) );
     win->window_rect = win->visible_rect = win->surface_rect = win->client_rect = empty_rect;
     memset( win->extra_bytes, 0, extra_bytes );
     list_init( &win->children );
@@ -964,13 +986,19 @@ static struct region *clip_children( struct window *parent, struct window *last,
 {
     struct window *ptr;
     struct region *tmp = create_empty_region();
+    rectangle_t extents, rect;
 
     if (!tmp) return NULL;
+    get_region_extents( region, &extents );
     LIST_FOR_EACH_ENTRY( ptr, &parent->children, struct window, entry )
     {
         if (ptr == last) break;
         if (!(ptr->style & WS_VISIBLE)) continue;
         if (ptr->ex_style & WS_EX_TRANSPARENT) continue;
+        /* skip children that can't affect the region */
+        rect = ptr->visible_rect;
+        offset_rect( &rect, offset_x, offset_y );
+        if (!intersect_rect( &rect, &rect, &extents )) continue;
         set_region_rect( tmp, &ptr->visible_rect );
         if (ptr->win_region && !intersect_window_region( tmp, ptr ))
         {
@@ -980,6 +1008,7 @@ static struct region *clip_children( struct window *parent, struct window *last,
         offset_region( tmp, offset_x, offset_y );
         if (!(region = subtract_region( region, region, tmp ))) break;
         if (is_region_empty( region )) break;
+        get_region_extents( region, &extents );
     }
     free_region( tmp );
     return region;
@@ -1017,7 +1046,7 @@ static inline struct window *get_top_clipping_window( struct window *win )
 
 
 /* compute the visible region of a window, in window coordinates */
-static struct region *get_visible_region( struct window *win, unsigned int flags )
+static struct region *compute_visible_region( struct window *win, unsigned int flags )
 {
     struct region *tmp = NULL, *region;
     int offset_x, offset_y;
@@ -1096,6 +1125,41 @@ error:
 }
 
 
+/* get the visible region of a window, in window coordinates; the caller must free it */
+static struct region *get_visible_region( struct window *win, unsigned int flags )
+{
+    struct visible_region_cache *cache = &win->vis_cache[(flags & DCX_WINDOW) ? 0 : 1];
+    struct region *region;
+    unsigned int error;
+
+    flags &= DCX_PARENTCLIP | DCX_WINDOW | DCX_CLIPCHILDREN;
+
+    if (cache->region && cache->serial == visible_region_serial && cache->flags == flags)
+    {
+        if (!(region = create_empty_region())) return NULL;
+        if (!copy_region( region, cache->region ))
+        {
+            free_region( region );
+            return NULL;
+        }
+        return region;
+    }
+
+    if (!(region = compute_visible_region( win, flags ))) return NULL;
+
+    error = get_error();
+    if (!cache->region) cache->region = create_empty_region();
+    if (cache->region && copy_region( cache->region, region ))
+    {
+        cache->flags = flags;
+        cache->serial = visible_region_serial;
+    }
+    else cache->serial = 0;
+    set_error( error );  /* ignore out of memory errors, the cache is optional */
+    return region;
+}
+
+
 /* clip all children with a custom pixel format out of the visible region */
 static struct region *clip_pixel_format_children( struct window *parent, struct region *parent_clip,
                                                   struct region *region, int offset_x, int offset_y )
@@ -1718,6 +1782,7 @@ static void set_window_pos( struct window *win, struct window *previous,
             offset_rect( &child->client_rect, new_size - old_size, 0 );
         }
     }
+    invalidate_visible_regions();
 
     /* reset cursor clip rectangle when the desktop changes size */
     if (win == win->desktop->top_window) set_clip_rectangle( win->desktop, NULL, 0 );
@@ -1857,6 +1922,7 @@ static void set_window_region( struct window *win, struct region *region, int re
 
     if (win->win_region) free_region( win->win_region );
     win->win_region = region;
+    invalidate_visible_regions();
 
     /* expose anything revealed by the change */
     if (old_vis_rgn && ((exposed_rgn = expose_window( win, &win->window_rect, old_vis_rgn ))))
@@ -1878,6 +1944,7 @@ void destroy_window( struct window *win )
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        invalidate_visible_regions();
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -1905,6 +1972,7 @@ void destroy_window( struct window *win )
     free_user_handle( win->handle );
     destroy_properties( win );
     list_remove( &win->entry );
+    invalidate_visible_regions();
     if (is_desktop_window(win))
     {
         struct desktop *desktop = win->desktop;
@@ -1920,6 +1988,8 @@ void destroy_window( struct window *win )
     detach_window_thread( win );
     if (win->win_region) free_region( win->win_region );
     if (win->update_region) free_region( win->update_region );
+    if (win->vis_cache[0].region) free_region( win->vis_cache[0].region );
+    if (win->vis_cache[1].region) free_region( win->vis_cache[1].region );
     if (win->class) release_class( win->class );
     free( win->text );
     memset( win, 0x55, sizeof(*win) + win->nb_extra_bytes - 1 );
@@ -1968,6 +2038,7 @@ DECL_HANDLER(create_window)
     }
     win->style = req->style;
     win->ex_style = req->ex_style;
+    invalidate_visible_regions();
 
     reply->handle    = win->handle;
     reply->parent    = win->parent ? win->parent->handle : 0;
@@ -2142,6 +2213,7 @@ DECL_HANDLER(set_window_info)
         else win->ex_style = (req->ex_style & ~WS_EX_TOPMOST) | (win->ex_style & WS_EX_TOPMOST);
         if (!(win->ex_style & WS_EX_LAYERED)) win->is_layered = 0;
     }
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE)) invalidate_visible_regions();
     if (req->flags & SET_WIN_ID) win->id = req->id;
     if (req->flags & SET_WIN_INSTANCE) win->instance = req->instance;
     if (req->flags & SET_WIN_UNICODE) win->is_unicode = req->is_unicode;
@@ -2349,6 +2421,7 @@ DECL_HANDLER(set_window_pos)
 
     win->paint_flags = (win->paint_flags & ~PAINT_CLIENT_FLAGS) | (req->paint_flags & PAINT_CLIENT_FLAGS);
     if (win->paint_flags & PAINT_HAS_PIXEL_FORMAT) update_pixel_format_flags( win );
+    invalidate_visible_regions();
 
     set_window_pos( win, previous, flags, &window_rect, &client_rect,
                     &visible_rect, &surface_rect, &valid_rect );
@@ -2673,6 +2746,7 @@ DECL_HANDLER(update_window_zorder)
         {
             list_remove( &win->entry );
             list_add_before( &ptr->entry, &win->entry );
+            invalidate_visible_regions();
         }
         break;
     }